@@ -1,20 +1,43 @@
 #version 330 core
 
+// Variants are made by MakeShaderVariant: SKINNED for animated models, nothing for
+// static geometry, which then skips the bone inputs and the skinning loop.
+// PACKED_VERTEX reads PackedModel vertices, whose unused bone slots are id 255.
+// BONE_UNIFORMS takes the matrices as plain uniforms, set one per bone, instead of
+// the BonePalette block.
+
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 norm;
 layout(location = 2) in vec2 tex;
 layout(location = 3) in vec3 tangent;
 layout(location = 4) in vec3 bitangent;
+#ifdef SKINNED
 layout(location = 5) in ivec4 boneIds;
 layout(location = 6) in vec4 weights;
+#endif
 
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
+#ifdef SKINNED
 const int MAX_BONES = 100;
 const int MAX_BONE_INFLUENCE = 4;
+#ifdef PACKED_VERTEX
+const int NO_BONE = 255;
+#else
+const int NO_BONE = -1;
+#endif
+#ifdef BONE_UNIFORMS
 uniform mat4 finalBonesMatrices[MAX_BONES];
+#else
+// filled by BonePalette, shared with every program that declares the block
+layout(std140) uniform BonePalette
+{
+    mat4 finalBonesMatrices[MAX_BONES];
+};
+#endif
+#endif
 
 out vec2 TexCoords;
 out vec3 FragPos;
@@ -22,13 +45,14 @@ out vec3 Normal;
 
 void main()
 {
+#ifdef SKINNED
     // --- Your original logic starts here ---
     vec4 totalPosition = vec4(0.0f);
     vec3 totalNormal = vec3(0.0f);
 
     for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
     {
-        if(boneIds[i] == -1)
+        if(boneIds[i] == NO_BONE)
             continue;
 
         if(boneIds[i] >= MAX_BONES)
@@ -52,6 +76,10 @@ void main()
         totalNormal   = norm;
     }
     // --- Your original logic ends here ---
+#else
+    vec4 totalPosition = vec4(pos, 1.0);
+    vec3 totalNormal = norm;
+#endif
 
     vec4 worldPos = model * totalPosition;
 
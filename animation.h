@@ -8,6 +8,11 @@
 #include <functional>
 #include <learnopengl/animdata.h>
 #include <learnopengl/model_animation.h>
+#include <learnopengl/skeleton.h>
+#include <learnopengl/resampled_clip.h>
+#include <learnopengl/compressed_clip.h>
+
+class BakedPoseTable;
 
 struct AssimpNodeData
 {
@@ -24,6 +29,14 @@ public:
 
 	Animation(const std::string& animationPath, Model* model)
 	{
+		Load(animationPath, model);
+	}
+
+	void Load(const std::string& animationPath, Model* model)
+	{
+		m_Bones.clear();
+		m_RootNode = AssimpNodeData();
+
 		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(animationPath, aiProcess_Triangulate);
 		assert(scene && scene->mRootNode);
@@ -35,6 +48,7 @@ public:
 		globalTransformation = globalTransformation.Inverse();
 		ReadHierarchyData(m_RootNode, scene->mRootNode);
 		ReadMissingBones(animation, *model);
+		m_Skeleton.Compile(m_RootNode, m_BoneInfoMap, m_Bones);
 	}
 
 	~Animation()
@@ -54,40 +68,97 @@ public:
 	}
 
 	
-	inline float GetTicksPerSecond() { return m_TicksPerSecond; }
-	inline float GetDuration() { return m_Duration;}
+	inline float GetTicksPerSecond() const { return m_TicksPerSecond; }
+	inline float GetDuration() const { return m_Duration;}
 	inline void setLoopKey(const float key) {this->loopKey = key;}
-	inline float GetLoopKey() {return this->loopKey;}
+	inline float GetLoopKey() const {return this->loopKey;}
 	inline const AssimpNodeData& GetRootNode() { return m_RootNode; }
-	inline const std::map<std::string,BoneInfo>& GetBoneIDMap() 
+	inline const Skeleton& GetSkeleton() const { return m_Skeleton; }
+	inline std::vector<Bone>& GetBones() { return m_Bones; }
+	inline const std::vector<Bone>& GetBones() const { return m_Bones; }
+
+	// Optional: bake the channels onto a uniform grid; the Animator then samples the
+	// grid instead of searching the keys. A compressed clip is resampled from its
+	// reduced keys, so the grid plays what compression kept rather than the source.
+	void Resample(float samplesPerSecond)
+	{
+		float samplesPerTick = samplesPerSecond / m_TicksPerSecond;
+		if (m_Compressed.IsBuilt())
+		{
+			const CompressedClip& compressed = m_Compressed;
+			m_Resampled.Build((int)m_Bones.size(), m_Duration, samplesPerTick,
+				[&compressed](int channel, float time, BoneCursor& cursor, glm::vec3& t, glm::quat& r, glm::vec3& scale)
+				{
+					compressed.Sample(channel, time, cursor, t, r, scale);
+				});
+		}
+		else
+			m_Resampled.Build(m_Bones, m_Duration, samplesPerTick);
+	}
+	inline const ResampledClip& GetResampledClip() const { return m_Resampled; }
+
+	// Optional: drop and quantise keys within the given bone-space tolerances; the
+	// Animator then samples the compressed keys
+	void Compress(float positionTolerance, float rotationTolerance, float scaleTolerance)
+	{
+		m_Compressed.Build(m_Bones, m_Duration, positionTolerance, rotationTolerance, scaleTolerance);
+	}
+	inline const CompressedClip& GetCompressedClip() const { return m_Compressed; }
+
+	// Takes channels and a hierarchy already in memory, e.g. read from a cache or
+	// generated by a test, in place of Load
+	void Assign(float duration, int ticksPerSecond, AssimpNodeData root, std::vector<Bone> bones,
+		const std::map<std::string, BoneInfo>& boneInfoMap)
+	{
+		m_Duration = duration;
+		m_TicksPerSecond = ticksPerSecond;
+		loopKey = 0;
+		m_RootNode = std::move(root);
+		m_Bones = std::move(bones);
+		m_BoneInfoMap = boneInfoMap;
+		m_Skeleton.Compile(m_RootNode, m_BoneInfoMap, m_Bones);
+	}
+
+	// Optional: final matrices pre-sampled for the whole clip, shared by everything
+	// that plays it; the table must outlive the animation's use
+	inline void SetBakedPoses(const BakedPoseTable* table) { m_BakedPoses = table; }
+	inline const BakedPoseTable* GetBakedPoses() const { return m_BakedPoses; }
+	inline const std::map<std::string,BoneInfo>& GetBoneIDMap() const
 	{ 
 		return m_BoneInfoMap;
 	}
 
 private:
-	void ReadMissingBones(const aiAnimation* animation, Model& model)
-	{
-		int size = animation->mNumChannels;
+	friend class AnimationCache;
 
+	// Bone id of a channel, adding bones the model's meshes do not reference
+	static int ResolveBoneID(const std::string& boneName, Model& model)
+	{
 		auto& boneInfoMap = model.GetBoneInfoMap();//getting m_BoneInfoMap from Model class
 		int& boneCount = model.GetBoneCount(); //getting the m_BoneCounter from Model class
 
+		if (boneInfoMap.find(boneName) == boneInfoMap.end())
+		{
+			boneInfoMap[boneName].id = boneCount;
+			boneCount++;
+		}
+		return boneInfoMap[boneName].id;
+	}
+
+	void ReadMissingBones(const aiAnimation* animation, Model& model)
+	{
+		int size = animation->mNumChannels;
+
 		//reading channels(bones engaged in an animation and their keyframes)
+		m_Bones.reserve(size);
 		for (int i = 0; i < size; i++)
 		{
 			auto channel = animation->mChannels[i];
 			std::string boneName = channel->mNodeName.data;
-
-			if (boneInfoMap.find(boneName) == boneInfoMap.end())
-			{
-				boneInfoMap[boneName].id = boneCount;
-				boneCount++;
-			}
-			m_Bones.push_back(Bone(channel->mNodeName.data,
-				boneInfoMap[channel->mNodeName.data].id, channel));
+			m_Bones.emplace_back(boneName, ResolveBoneID(boneName, model), channel);
 		}
 
-		m_BoneInfoMap = boneInfoMap;
+		m_BoneInfoMap = model.GetBoneInfoMap();
 	}
 
 	void ReadHierarchyData(AssimpNodeData& dest, const aiNode* src)
@@ -98,12 +169,10 @@ private:
 		dest.transformation = AssimpGLMHelpers::ConvertMatrixToGLMFormat(src->mTransformation);
 		dest.childrenCount = src->mNumChildren;
 
+		// children are filled in place; building them separately copied every subtree
+		dest.children.resize(src->mNumChildren);
 		for (int i = 0; i < src->mNumChildren; i++)
-		{
-			AssimpNodeData newData;
-			ReadHierarchyData(newData, src->mChildren[i]);
-			dest.children.push_back(newData);
-		}
+			ReadHierarchyData(dest.children[i], src->mChildren[i]);
 	}
 	float m_Duration;
 	int m_TicksPerSecond;
@@ -111,5 +180,9 @@ private:
 	std::vector<Bone> m_Bones;
 	AssimpNodeData m_RootNode;
 	std::map<std::string, BoneInfo> m_BoneInfoMap;
+	Skeleton m_Skeleton;
+	ResampledClip m_Resampled;
+	CompressedClip m_Compressed;
+	const BakedPoseTable* m_BakedPoses = nullptr;
 };
 
@@ -0,0 +1,313 @@
+#pragma once
+
+/* Binary cache of an animation file's node hierarchy and first clip, so later
+   launches skip Assimp for clips. The file is mapped and parsed in one pass; it is
+   rebaked when the source file changes (see SourceFile). Bone ids are not stored: they are
+   resolved against the model at load, exactly as Animation::ReadMissingBones does.
+
+   Layout, little-endian, no padding:
+     AnimationCacheHeader
+     nodes, preorder:  float transformation[16], uint32 childCount, uint32 nameLength, char name[]
+     channels:         uint32 nameLength, char name[],
+                       uint32 count, { float x, y, z, time }[count]         positions
+                       uint32 count, { float x, y, z, w, time }[count]      rotations
+                       uint32 count, { float x, y, z, time }[count]         scales */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <learnopengl/animation.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/assimp_glm_helpers.h>
+
+struct AnimationCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    SourceStamp source;
+    double duration;
+    double ticksPerSecond;
+    uint32_t nodeCount;
+    uint32_t channelCount;
+    uint64_t payloadSize;
+};
+
+class AnimationCache
+{
+public:
+    static const uint32_t VERSION = 2;
+
+    // Reads the source with Assimp and writes the cache; needs no model or GL context
+    static bool Bake(SourceFile& source, const std::string& cachePath)
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(source.GetPath(), aiProcess_Triangulate);
+        if (!scene || !scene->mRootNode || scene->mNumAnimations == 0)
+        {
+            std::cout << "Failed to bake animation " << source.GetPath() << std::endl;
+            return false;
+        }
+        const aiAnimation* animation = scene->mAnimations[0];
+
+        AnimationCacheHeader header;
+        memcpy(header.magic, "HANI", 4);
+        header.version = VERSION;
+        if (!source.Stamp(header.source))
+            return false;
+        header.duration = animation->mDuration;
+        header.ticksPerSecond = animation->mTicksPerSecond;
+        header.nodeCount = 0;
+        header.channelCount = animation->mNumChannels;
+
+        std::vector<unsigned char> payload;
+        WriteNode(payload, scene->mRootNode, header.nodeCount);
+
+        for (unsigned int i = 0; i < animation->mNumChannels; i++)
+        {
+            const aiNodeAnim* channel = animation->mChannels[i];
+            WriteString(payload, channel->mNodeName.data);
+
+            Append<uint32_t>(payload, channel->mNumPositionKeys);
+            for (unsigned int k = 0; k < channel->mNumPositionKeys; k++)
+                WriteVec3Key(payload, channel->mPositionKeys[k]);
+
+            Append<uint32_t>(payload, channel->mNumRotationKeys);
+            for (unsigned int k = 0; k < channel->mNumRotationKeys; k++)
+            {
+                glm::quat q = AssimpGLMHelpers::GetGLMQuat(channel->mRotationKeys[k].mValue);
+                Append<float>(payload, q.x);
+                Append<float>(payload, q.y);
+                Append<float>(payload, q.z);
+                Append<float>(payload, q.w);
+                Append<float>(payload, (float)channel->mRotationKeys[k].mTime);
+            }
+
+            Append<uint32_t>(payload, channel->mNumScalingKeys);
+            for (unsigned int k = 0; k < channel->mNumScalingKeys; k++)
+                WriteVec3Key(payload, channel->mScalingKeys[k]);
+        }
+        header.payloadSize = payload.size();
+
+        std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "Failed to write animation cache " << cachePath << std::endl;
+            return false;
+        }
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)payload.data(), payload.size());
+        return (bool)out;
+    }
+
+    // Fills animation from the cache if it exists and matches the source file
+    static bool Read(const std::string& cachePath, SourceFile& source,
+        Model* model, Animation& animation)
+    {
+        MappedFile file;
+        AnimationCacheHeader header;
+        if (!OpenCurrent(cachePath, source, file, header))
+            return false;
+
+        Reader reader{ file.GetData() + sizeof(header), (size_t)header.payloadSize, 0, true };
+
+        AssimpNodeData root;
+        uint32_t nodeCount = 0;
+        ReadNode(reader, root, nodeCount);
+
+        // parse everything before touching the model, so a truncated file changes nothing
+        std::vector<std::string> names(header.channelCount);
+        std::vector<std::vector<KeyPosition>> positions(header.channelCount);
+        std::vector<std::vector<KeyRotation>> rotations(header.channelCount);
+        std::vector<std::vector<KeyScale>> scales(header.channelCount);
+        for (uint32_t i = 0; i < header.channelCount && reader.ok; i++)
+        {
+            names[i] = reader.ReadString();
+
+            positions[i].resize(reader.ReadCount(4 * sizeof(float)));
+            for (KeyPosition& key : positions[i])
+                key.position = reader.ReadVec3(key.timeStamp);
+
+            rotations[i].resize(reader.ReadCount(5 * sizeof(float)));
+            for (KeyRotation& key : rotations[i])
+            {
+                float x = reader.Read<float>(), y = reader.Read<float>(), z = reader.Read<float>(), w = reader.Read<float>();
+                key.orientation = glm::quat(w, x, y, z);
+                key.timeStamp = reader.Read<float>();
+            }
+
+            scales[i].resize(reader.ReadCount(4 * sizeof(float)));
+            for (KeyScale& key : scales[i])
+                key.scale = reader.ReadVec3(key.timeStamp);
+        }
+
+        if (!reader.ok || nodeCount != header.nodeCount)
+        {
+            std::cout << "Animation cache " << cachePath << " is corrupt, rebaking" << std::endl;
+            return false;
+        }
+
+        std::vector<Bone> bones;
+        bones.reserve(header.channelCount);
+        for (uint32_t i = 0; i < header.channelCount; i++)
+        {
+            bones.emplace_back(names[i], Animation::ResolveBoneID(names[i], *model),
+                std::move(positions[i]), std::move(rotations[i]), std::move(scales[i]));
+        }
+        animation.Assign((float)header.duration, (int)header.ticksPerSecond, std::move(root), std::move(bones),
+            model->GetBoneInfoMap());
+        return true;
+    }
+
+    // True when the cache exists and was baked from the current source; needs no model,
+    // so stale caches can be rebaked off the main thread
+    static bool IsCurrent(const std::string& cachePath, SourceFile& source)
+    {
+        MappedFile file;
+        AnimationCacheHeader header;
+        return OpenCurrent(cachePath, source, file, header);
+    }
+
+private:
+    static bool OpenCurrent(const std::string& cachePath, SourceFile& source,
+        MappedFile& file, AnimationCacheHeader& header)
+    {
+        if (!file.Open(cachePath))
+            return false;
+
+        if (file.GetSize() < sizeof(header))
+            return false;
+        memcpy(&header, file.GetData(), sizeof(header));
+
+        if (memcmp(header.magic, "HANI", 4) != 0 ||
+            header.version != VERSION ||
+            !source.IsCurrent(header.source) ||
+            sizeof(header) + header.payloadSize > file.GetSize())
+        {
+            std::cout << "Animation cache " << cachePath << " is stale, rebaking" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Bounds-checked cursor over the mapped payload; reads past the end clear ok
+    struct Reader
+    {
+        const unsigned char* data;
+        size_t size;
+        size_t pos;
+        bool ok;
+
+        template <typename T>
+        T Read()
+        {
+            T value = T();
+            if (pos + sizeof(T) > size)
+            {
+                ok = false;
+                return value;
+            }
+            memcpy(&value, data + pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+        }
+
+        // element count of an array, rejected if the elements can not fit
+        size_t ReadCount(size_t elementSize)
+        {
+            uint32_t count = Read<uint32_t>();
+            if (!ok || (size_t)count * elementSize > size - pos)
+            {
+                ok = false;
+                return 0;
+            }
+            return count;
+        }
+
+        std::string ReadString()
+        {
+            size_t length = ReadCount(1);
+            std::string value((const char*)data + pos, length);
+            pos += length;
+            return value;
+        }
+
+        glm::vec3 ReadVec3(float& outTime)
+        {
+            float x = Read<float>(), y = Read<float>(), z = Read<float>();
+            outTime = Read<float>();
+            return glm::vec3(x, y, z);
+        }
+    };
+
+    template <typename T>
+    static void Append(std::vector<unsigned char>& out, T value)
+    {
+        size_t offset = out.size();
+        out.resize(offset + sizeof(T));
+        memcpy(out.data() + offset, &value, sizeof(T));
+    }
+
+    static void WriteString(std::vector<unsigned char>& out, const std::string& value)
+    {
+        Append<uint32_t>(out, (uint32_t)value.size());
+        out.insert(out.end(), value.begin(), value.end());
+    }
+
+    static void WriteVec3Key(std::vector<unsigned char>& out, const aiVectorKey& key)
+    {
+        glm::vec3 v = AssimpGLMHelpers::GetGLMVec(key.mValue);
+        Append<float>(out, v.x);
+        Append<float>(out, v.y);
+        Append<float>(out, v.z);
+        Append<float>(out, (float)key.mTime);
+    }
+
+    static void WriteNode(std::vector<unsigned char>& out, const aiNode* node, uint32_t& nodeCount)
+    {
+        glm::mat4 transformation = AssimpGLMHelpers::ConvertMatrixToGLMFormat(node->mTransformation);
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                Append<float>(out, transformation[c][r]);
+        Append<uint32_t>(out, node->mNumChildren);
+        WriteString(out, node->mName.data);
+        nodeCount++;
+
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+            WriteNode(out, node->mChildren[i], nodeCount);
+    }
+
+    static void ReadNode(Reader& reader, AssimpNodeData& dest, uint32_t& nodeCount)
+    {
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                dest.transformation[c][r] = reader.Read<float>();
+        // every child takes at least a matrix, a count and a name length
+        dest.childrenCount = (int)reader.ReadCount(16 * sizeof(float) + 2 * sizeof(uint32_t));
+        dest.name = reader.ReadString();
+        nodeCount++;
+        if (!reader.ok)
+            return;
+
+        dest.children.resize(dest.childrenCount);
+        for (int i = 0; i < dest.childrenCount && reader.ok; i++)
+            ReadNode(reader, dest.children[i], nodeCount);
+    }
+};
+
+// Loads an animation from its cache, baking the cache from the source first when it
+// is missing or stale; falls back to reading the source directly
+inline void LoadAnimation(Animation& animation, SourceFile& source, Model* model)
+{
+    std::string cachePath = source.GetPath() + ".anim";
+    if (AnimationCache::Read(cachePath, source, model, animation))
+        return;
+    if (AnimationCache::Bake(source, cachePath) && AnimationCache::Read(cachePath, source, model, animation))
+        return;
+    animation.Load(source.GetPath(), model);
+}
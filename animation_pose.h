@@ -0,0 +1,99 @@
+#pragma once
+
+/* Pose evaluation of an Animation at a given time, shared by the Animator, crowds
+   and pose baking. The clip is only read, so callers bring their own cursors and
+   scratch memory. */
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <learnopengl/animation.h>
+#include <learnopengl/bone.h>
+#include <learnopengl/pose_simd.h>
+
+// Working memory of one pose evaluation, reused between updates so evaluation
+// does not allocate once the sizes have settled
+struct PoseScratch
+{
+    LocalPose localPose;
+    std::vector<Affine3x4> localTransforms;
+    std::vector<Affine3x4> globalTransforms;
+};
+
+// Local translation, rotation and scale of every channel of animation at time, from
+// the resampled grid, the compressed keys or the source keys. Channels that only
+// drive nodes less than cullLeafLevels above a leaf are skipped. Returns the number
+// of channels sampled.
+inline int SampleAnimationPose(const Animation& animation, float time,
+    std::vector<BoneCursor>& cursors, LocalPose& outPose, int cullLeafLevels = 0)
+{
+    const std::vector<Bone>& bones = animation.GetBones();
+    const ResampledClip& resampled = animation.GetResampledClip();
+    const CompressedClip& compressed = animation.GetCompressedClip();
+
+    // the whole grid frame is blended in one batch unless channels are culled
+    if (resampled.IsBuilt() && cullLeafLevels <= 0)
+    {
+        resampled.SampleAll(time, outPose);
+        return resampled.GetChannelCount();
+    }
+
+    const std::vector<int>& channelHeights = animation.GetSkeleton().GetChannelHeights();
+    int sampled = 0;
+    cursors.resize(bones.size());
+    outPose.Resize((int)bones.size());
+    for (int c = 0; c < (int)bones.size(); c++)
+    {
+        if (cullLeafLevels > 0 && c < (int)channelHeights.size() && channelHeights[c] < cullLeafLevels)
+            continue;
+
+        sampled++;
+        glm::vec3 position, scale;
+        glm::quat rotation;
+        if (resampled.IsBuilt())
+            resampled.Sample(c, time, position, rotation, scale);
+        else if (compressed.IsBuilt())
+            compressed.Sample(c, time, cursors[c], position, rotation, scale);
+        else
+            bones[c].Sample(time, cursors[c], position, rotation, scale);
+        outPose.Set(c, position, rotation, scale);
+    }
+    return sampled;
+}
+
+// Writes the skinning matrices of animation at time into finalBoneMatrices[0, matrixCount).
+// Walks the compiled skeleton parent-before-child; same result as
+// Animator::CalculateBoneTransform from the root without the recursion and name
+// lookups. Channels are sampled into SoA streams and composed to 3x4s in SIMD
+// batches. The animation is only read, so any number of instances can evaluate it
+// at once as long as each has its own cursors and scratch. Returns the number of
+// channels sampled.
+inline int EvaluateAnimationPose(const Animation& animation, float time, std::vector<BoneCursor>& cursors,
+    PoseScratch& scratch, glm::mat4* finalBoneMatrices, size_t matrixCount, int cullLeafLevels = 0)
+{
+    const std::vector<SkeletonNode>& nodes = animation.GetSkeleton().GetNodes();
+    scratch.globalTransforms.resize(nodes.size());
+    scratch.localTransforms.resize(animation.GetBones().size());
+
+    int sampled = SampleAnimationPose(animation, time, cursors, scratch.localPose, cullLeafLevels);
+    ComposeAffine(scratch.localPose, scratch.localTransforms.data());
+
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const SkeletonNode& node = nodes[i];
+        bool animated = node.channel >= 0 && node.height >= cullLeafLevels;
+        const Affine3x4& local = animated ? scratch.localTransforms[node.channel] : node.bindAffine;
+
+        if (node.parent >= 0)
+            MultiplyAffine(scratch.globalTransforms[node.parent], local, scratch.globalTransforms[i]);
+        else
+            scratch.globalTransforms[i] = local;
+
+        if (node.boneIndex >= 0 && node.boneIndex < (int)matrixCount)
+        {
+            Affine3x4 skin;
+            MultiplyAffine(scratch.globalTransforms[i], node.offsetAffine, skin);
+            AffineToMat4(skin, finalBoneMatrices[node.boneIndex]);
+        }
+    }
+    return sampled;
+}
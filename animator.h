@@ -3,10 +3,32 @@
 #include <glm/glm.hpp>
 #include <map>
 #include <vector>
+#include <algorithm>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
 #include <learnopengl/animation.h>
 #include <learnopengl/bone.h>
+#include <learnopengl/animation_pose.h>
+#include <learnopengl/baked_pose_table.h>
+
+// Non-owning view of one pose's final bone matrices. It stays valid until the
+// buffer it points at is written again, i.e. across one SwapPoseBuffers.
+struct BoneMatrixView
+{
+    const glm::mat4* data;
+    size_t count;
+
+    inline const glm::mat4& operator[](size_t i) const { return data[i]; }
+    inline size_t size() const { return count; }
+};
+
+// One distance band of animation level of detail
+struct AnimationLOD
+{
+    float maxDistance;      // the band applies up to this distance from the camera
+    float updateRate;       // full evaluations per second, interpolated between; 0 = every frame
+    int cullLeafLevels;     // nodes within this many levels of a leaf keep their bind pose
+};
 
 class Animator
 {
@@ -16,30 +38,72 @@ public:
         m_CurrentTime = 0.0;
         m_CurrentAnimation = animation;
 
-        m_FinalBoneMatrices.reserve(100);
-
-        for (int i = 0; i < 100; i++)
-            m_FinalBoneMatrices.push_back(glm::mat4(1.0f));
+        // the pose is written into the back buffer while the front one is read
+        for (int b = 0; b < 2; b++)
+            m_PoseBuffers[b].assign(100, glm::mat4(1.0f));
+        m_WriteIndex = 1;
     }
 
     void UpdateAnimation(float dt)
     {
         m_DeltaTime = dt;
+        m_BonesEvaluated = 0;
         if (m_CurrentAnimation)
         {
-            m_CurrentTime += m_CurrentAnimation->GetTicksPerSecond() * dt;
-            if (m_CurrentTime >= m_CurrentAnimation->GetDuration()) m_CurrentTime = m_CurrentAnimation->GetLoopKey();
-            m_CurrentTime = fmod(m_CurrentTime, m_CurrentAnimation->GetDuration());
-            CalculateBoneTransform(&m_CurrentAnimation->GetRootNode(), glm::mat4(1.0f));
+            m_CurrentTime = AdvanceTime(m_CurrentTime, m_CurrentAnimation->GetTicksPerSecond() * dt);
+
+            const AnimationLOD* lod = FindLOD();
+            if (const BakedPoseTable* baked = m_CurrentAnimation->GetBakedPoses())
+            {
+                std::vector<glm::mat4>& finalBoneMatrices = m_PoseBuffers[m_WriteIndex];
+                baked->Sample(m_CurrentTime, finalBoneMatrices.data(), finalBoneMatrices.size());
+            }
+            else if (lod && lod->updateRate > 0.0f)
+            {
+                UpdateSparse(dt, *lod);
+            }
+            else
+            {
+                m_LODValid = false;
+                std::vector<glm::mat4>& finalBoneMatrices = m_PoseBuffers[m_WriteIndex];
+                m_BonesEvaluated = EvaluateAnimationPose(*m_CurrentAnimation, m_CurrentTime, m_Cursors, m_Scratch,
+                    finalBoneMatrices.data(), finalBoneMatrices.size(), lod ? lod->cullLeafLevels : 0);
+            }
         }
     }
 
+    void EvaluatePose()
+    {
+        std::vector<glm::mat4>& finalBoneMatrices = m_PoseBuffers[m_WriteIndex];
+        m_BonesEvaluated = EvaluateAnimationPose(*m_CurrentAnimation, m_CurrentTime, m_Cursors, m_Scratch,
+            finalBoneMatrices.data(), finalBoneMatrices.size());
+    }
+
+    // Bands sorted by increasing maxDistance; beyond the last band the last one
+    // applies. No bands means full evaluation every frame.
+    void SetLODBands(const std::vector<AnimationLOD>& bands)
+    {
+        m_LODBands = bands;
+        m_LODValid = false;
+    }
+
+    inline void SetLODDistance(float distance) { m_LODDistance = distance; }
+
+    // Channels sampled by the last UpdateAnimation; 0 on frames that only
+    // interpolated between sparse updates
+    inline int GetBonesEvaluated() const { return m_BonesEvaluated; }
+
     void PlayAnimation(Animation* pAnimation)
     {
         m_CurrentAnimation = pAnimation;
         m_CurrentTime = 0.0f;
+        m_Cursors.assign(pAnimation ? pAnimation->GetBones().size() : 0, BoneCursor());
+        m_LODValid = false;
     }
 
+    // Seeks without evaluating, e.g. before calling CalculateBoneTransform directly
+    inline void SetCurrentTime(float time) { m_CurrentTime = time; }
+
     void CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform)
     {
         std::string nodeName = node->name;
@@ -55,27 +119,104 @@ public:
 
         glm::mat4 globalTransformation = parentTransform * nodeTransform;
 
-        auto boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
-        if (boneInfoMap.find(nodeName) != boneInfoMap.end())
+        const auto& boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
+        auto boneInfo = boneInfoMap.find(nodeName);
+        if (boneInfo != boneInfoMap.end())
         {
-            int index = boneInfoMap[nodeName].id;
-            glm::mat4 offset = boneInfoMap[nodeName].offset;
-            m_FinalBoneMatrices[index] = globalTransformation * offset;
+            int index = boneInfo->second.id;
+            glm::mat4 offset = boneInfo->second.offset;
+            m_PoseBuffers[m_WriteIndex][index] = globalTransformation * offset;
         }
 
         for (int i = 0; i < node->childrenCount; i++)
             CalculateBoneTransform(&node->children[i], globalTransformation);
     }
 
+    // Publishes the pose written by the last update; call once per frame between
+    // UpdateAnimation and reading GetBoneMatrices
+    void SwapPoseBuffers()
+    {
+        m_WriteIndex ^= 1;
+    }
+
+    // Last published pose, without copying
+    inline BoneMatrixView GetBoneMatrices() const
+    {
+        const std::vector<glm::mat4>& front = m_PoseBuffers[m_WriteIndex ^ 1];
+        return BoneMatrixView{ front.data(), front.size() };
+    }
+
     std::vector<glm::mat4> GetFinalBoneMatrices()
     {
-        return m_FinalBoneMatrices;
+        return m_PoseBuffers[m_WriteIndex ^ 1];
     }
 
     Animation* GetCurrentAnimation() { return m_CurrentAnimation; }
 
 private:
-    std::vector<glm::mat4> m_FinalBoneMatrices;
+    // Same looping as before LOD: past the end jumps to the loop key
+    float AdvanceTime(float time, float ticks) const
+    {
+        time += ticks;
+        if (time >= m_CurrentAnimation->GetDuration()) time = m_CurrentAnimation->GetLoopKey();
+        return fmod(time, m_CurrentAnimation->GetDuration());
+    }
+
+    const AnimationLOD* FindLOD() const
+    {
+        for (const AnimationLOD& band : m_LODBands)
+            if (m_LODDistance <= band.maxDistance)
+                return &band;
+        return m_LODBands.empty() ? nullptr : &m_LODBands.back();
+    }
+
+    // Evaluates a pose one update interval ahead and blends the skinning matrices
+    // towards it until the interval has passed
+    void UpdateSparse(float dt, const AnimationLOD& lod)
+    {
+        float interval = 1.0f / lod.updateRate;
+        size_t count = m_PoseBuffers[0].size();
+        m_LODElapsed += dt;
+
+        if (!m_LODValid || m_LODElapsed >= m_LODInterval || interval != m_LODInterval)
+        {
+            m_LODFrom.resize(count, glm::mat4(1.0f));
+            m_LODTo.resize(count, glm::mat4(1.0f));
+            if (m_LODValid)
+                m_LODFrom.swap(m_LODTo);
+            else
+                m_BonesEvaluated += EvaluateAnimationPose(*m_CurrentAnimation, m_CurrentTime, m_Cursors, m_Scratch,
+                    m_LODFrom.data(), count, lod.cullLeafLevels);
+
+            float ahead = AdvanceTime(m_CurrentTime, m_CurrentAnimation->GetTicksPerSecond() * interval);
+            m_BonesEvaluated += EvaluateAnimationPose(*m_CurrentAnimation, ahead, m_Cursors, m_Scratch,
+                m_LODTo.data(), count, lod.cullLeafLevels);
+
+            m_LODInterval = interval;
+            m_LODElapsed = 0.0f;
+            m_LODValid = true;
+        }
+
+        float alpha = std::min(m_LODElapsed / m_LODInterval, 1.0f);
+        std::vector<glm::mat4>& finalBoneMatrices = m_PoseBuffers[m_WriteIndex];
+        for (size_t i = 0; i < count; i++)
+            for (int c = 0; c < 4; c++)
+                finalBoneMatrices[i][c] = glm::mix(m_LODFrom[i][c], m_LODTo[i][c], alpha);
+    }
+
+    std::vector<glm::mat4> m_PoseBuffers[2];
+    int m_WriteIndex;
+    std::vector<BoneCursor> m_Cursors;
+    PoseScratch m_Scratch;
+
+    std::vector<AnimationLOD> m_LODBands;
+    float m_LODDistance = 0.0f;
+    std::vector<glm::mat4> m_LODFrom;   // last two sparse evaluations
+    std::vector<glm::mat4> m_LODTo;
+    float m_LODElapsed = 0.0f;
+    float m_LODInterval = 0.0f;
+    bool m_LODValid = false;
+    int m_BonesEvaluated = 0;
     Animation* m_CurrentAnimation;
     float m_CurrentTime;
     float m_DeltaTime;
@@ -0,0 +1,228 @@
+#pragma once
+
+/* Startup loading as a graph of tasks. A task's work runs on a ThreadPool worker
+   once all of its dependencies have finished; work that needs the GL context (an
+   upload after a decode, or a whole Model, whose meshes create buffers as they are
+   built) is queued for the main thread instead and runs inside Pump or Wait. Every
+   task records when it became ready, ran and finished, for startup profiling. */
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <learnopengl/thread_pool.h>
+
+typedef int AssetTask;
+
+class AssetLoader
+{
+public:
+    // With a single-thread pool every task runs inline, which gives the serial baseline
+    AssetLoader(ThreadPool& pool)
+        : m_Pool(pool), m_Start(std::chrono::steady_clock::now())
+    {
+    }
+
+    // Finishes every task first, since workers may still be running them
+    ~AssetLoader()
+    {
+        std::vector<AssetTask> all;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (size_t i = 0; i < m_Tasks.size(); i++)
+                all.push_back((AssetTask)i);
+        }
+        Wait(all);
+    }
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // work runs on a worker, then upload (if any) on the main thread
+    AssetTask Add(const std::string& name, std::function<void()> work,
+        const std::vector<AssetTask>& dependencies = {}, std::function<void()> upload = nullptr)
+    {
+        return AddTask(name, std::move(work), std::move(upload), false, dependencies);
+    }
+
+    // work runs on the main thread, for loaders that make GL calls throughout
+    AssetTask AddMainThread(const std::string& name, std::function<void()> work,
+        const std::vector<AssetTask>& dependencies = {})
+    {
+        return AddTask(name, std::move(work), nullptr, true, dependencies);
+    }
+
+    bool IsDone(AssetTask task)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Tasks[task]->done;
+    }
+
+    // Runs the main-thread work queued so far; call once per frame while loading
+    void Pump()
+    {
+        std::function<void()> job;
+        while (PopMainThread(job))
+            job();
+    }
+
+    // Pumps main-thread work until every task in tasks has finished
+    void Wait(const std::vector<AssetTask>& tasks)
+    {
+        for (;;)
+        {
+            Pump();
+
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            bool done = true;
+            for (AssetTask task : tasks)
+                done = done && m_Tasks[task]->done;
+            if (done)
+                return;
+            if (m_MainThreadJobs.empty())
+                m_Changed.wait(lock);
+        }
+    }
+
+    // Times of every task, in ms since the loader was created
+    void PrintTimings()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        double end = 0.0;
+        for (const std::unique_ptr<Task>& task : m_Tasks)
+        {
+            std::cout << "  " << task->name << ": ready " << task->readyTime << " ms, "
+                << (task->mainThread ? "main thread " : "worker ") << task->workTime << " ms";
+            if (task->upload)
+                std::cout << ", upload " << task->uploadTime << " ms";
+            std::cout << ", done at " << task->doneTime << " ms" << std::endl;
+            end = std::max(end, task->doneTime);
+        }
+        std::cout << "Assets loaded in " << end << " ms on " << m_Pool.GetThreadCount() << " threads" << std::endl;
+    }
+
+private:
+    struct Task
+    {
+        std::string name;
+        std::function<void()> work;
+        std::function<void()> upload;
+        bool mainThread;
+        int waitingOn;                      // unfinished dependencies
+        std::vector<AssetTask> dependents;
+        bool done;
+        double readyTime;
+        double workTime;
+        double uploadTime;
+        double doneTime;
+    };
+
+    double Now() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count();
+    }
+
+    AssetTask AddTask(const std::string& name, std::function<void()> work, std::function<void()> upload,
+        bool mainThread, const std::vector<AssetTask>& dependencies)
+    {
+        AssetTask id;
+        bool ready;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            id = (AssetTask)m_Tasks.size();
+            m_Tasks.emplace_back(new Task{ name, std::move(work), std::move(upload), mainThread, 0, {}, false, 0.0, 0.0, 0.0, 0.0 });
+            for (AssetTask dependency : dependencies)
+            {
+                if (m_Tasks[dependency]->done)
+                    continue;
+                m_Tasks[dependency]->dependents.push_back(id);
+                m_Tasks[id]->waitingOn++;
+            }
+            ready = m_Tasks[id]->waitingOn == 0;
+        }
+
+        // outside the lock: a pool without workers runs the task right here
+        if (ready)
+            Schedule(id);
+        return id;
+    }
+
+    void Schedule(AssetTask id)
+    {
+        Task* task;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            task = m_Tasks[id].get();
+            task->readyTime = Now();
+        }
+
+        if (task->mainThread)
+            PushMainThread([this, id, task]() { Run(task->work, task->workTime); Finish(id); });
+        else
+            m_Pool.Submit([this, id, task]()
+                {
+                    Run(task->work, task->workTime);
+                    if (task->upload)
+                        PushMainThread([this, id, task]() { Run(task->upload, task->uploadTime); Finish(id); });
+                    else
+                        Finish(id);
+                });
+    }
+
+    void Run(const std::function<void()>& fn, double& outTime)
+    {
+        double start = Now();
+        fn();
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        outTime = Now() - start;
+    }
+
+    void Finish(AssetTask id)
+    {
+        std::vector<AssetTask> ready;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            Task& task = *m_Tasks[id];
+            task.done = true;
+            task.doneTime = Now();
+            for (AssetTask dependent : task.dependents)
+                if (--m_Tasks[dependent]->waitingOn == 0)
+                    ready.push_back(dependent);
+            // under the lock, so a waiter that sees done can not destroy the loader first
+            m_Changed.notify_all();
+        }
+
+        for (AssetTask dependent : ready)
+            Schedule(dependent);
+    }
+
+    void PushMainThread(std::function<void()> job)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_MainThreadJobs.push_back(std::move(job));
+        m_Changed.notify_all();
+    }
+
+    bool PopMainThread(std::function<void()>& job)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_MainThreadJobs.empty())
+            return false;
+        job = std::move(m_MainThreadJobs.front());
+        m_MainThreadJobs.pop_front();
+        return true;
+    }
+
+    ThreadPool& m_Pool;
+    std::chrono::steady_clock::time_point m_Start;
+    std::mutex m_Mutex;
+    std::condition_variable m_Changed;  // a task finished or main-thread work arrived
+    std::vector<std::unique_ptr<Task>> m_Tasks;
+    std::deque<std::function<void()>> m_MainThreadJobs;
+};
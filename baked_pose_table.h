@@ -0,0 +1,260 @@
+#pragma once
+
+/* Final skinning matrices of a clip pre-sampled at a fixed frame rate, for loops
+   that play without blending. Playback is a table lookup, optionally lerping the
+   two neighbouring frames. One table serves every instance playing the clip, and
+   it can be saved next to the source asset and mapped back in on later launches.
+
+   Layout on disk:
+     BakedPoseHeader
+     Affine3x4 frames[frameCount][boneCount]      (at frameOffset) */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <learnopengl/animation_pose.h>
+#include <learnopengl/mapped_file.h>
+
+struct BakedPoseHeader
+{
+    char magic[4];
+    uint32_t version;
+    SourceStamp source;
+    uint64_t skinHash;          // bone names, ids and offsets of the model
+    uint32_t sampling;          // BakedPoseSampling the frames were evaluated from
+    uint32_t padding;
+    uint64_t samplingHash;      // content of the resampled or compressed clip, 0 for keys
+    uint32_t frameCount;
+    uint32_t boneCount;
+    float framesPerTick;
+    float duration;
+    uint64_t frameOffset;
+};
+
+// Which representation of the clip EvaluateAnimationPose read while baking
+enum BakedPoseSampling : uint32_t
+{
+    BAKED_FROM_KEYS = 0,
+    BAKED_FROM_COMPRESSED = 1,
+    BAKED_FROM_RESAMPLED = 2
+};
+
+class BakedPoseTable
+{
+public:
+    static const uint32_t VERSION = 2;
+
+    BakedPoseTable() = default;
+    BakedPoseTable(const BakedPoseTable&) = delete;
+    BakedPoseTable& operator=(const BakedPoseTable&) = delete;
+
+    // Samples animation at framesPerSecond into boneCount matrices per frame
+    void Bake(const Animation& animation, float framesPerSecond, int boneCount = 100)
+    {
+        m_File.Close();
+        m_BoneCount = boneCount;
+        m_Duration = animation.GetDuration();
+        m_FrameCount = std::max(2, (int)std::ceil(m_Duration * framesPerSecond / animation.GetTicksPerSecond()) + 1);
+        m_FramesPerTick = (m_FrameCount - 1) / m_Duration;
+
+        std::vector<BoneCursor> cursors;
+        PoseScratch scratch;
+        std::vector<glm::mat4> pose(boneCount, glm::mat4(1.0f));
+        m_Storage.resize((size_t)m_FrameCount * boneCount);
+
+        for (int f = 0; f < m_FrameCount; f++)
+        {
+            EvaluateAnimationPose(animation, f / m_FramesPerTick, cursors, scratch, pose.data(), pose.size());
+            for (int b = 0; b < boneCount; b++)
+                m_Storage[(size_t)f * boneCount + b] = AffineFromMat4(pose[b]);
+        }
+        m_Frames = m_Storage.data();
+        GetSampling(animation, m_Sampling, m_SamplingHash);
+        m_SkinHash = HashSkin(animation);
+    }
+
+    // Writes the pose at animationTime (in ticks) into out[0, min(count, boneCount))
+    void Sample(float animationTime, glm::mat4* out, size_t count) const
+    {
+        float frame = glm::clamp(animationTime * m_FramesPerTick, 0.0f, (float)(m_FrameCount - 1));
+        int f0 = std::min((int)frame, m_FrameCount - 2);
+        float alpha = frame - f0;
+        size_t n = std::min(count, (size_t)m_BoneCount);
+
+        if (!m_Interpolate)
+        {
+            const Affine3x4* nearest = GetFrame(alpha < 0.5f ? f0 : f0 + 1);
+            for (size_t b = 0; b < n; b++)
+                AffineToMat4(nearest[b], out[b]);
+            return;
+        }
+
+        const Affine3x4* a = GetFrame(f0);
+        const Affine3x4* c = GetFrame(f0 + 1);
+        for (size_t b = 0; b < n; b++)
+        {
+            Affine3x4 blended;
+            const float* pa = &a[b].m[0][0];
+            const float* pc = &c[b].m[0][0];
+            float* dst = &blended.m[0][0];
+            for (int e = 0; e < 12; e++)
+                dst[e] = pa[e] + (pc[e] - pa[e]) * alpha;
+            AffineToMat4(blended, out[b]);
+        }
+    }
+
+    // Points the table at a mapped cache if it exists and matches the source asset
+    // and was baked from the same skin and clip representation animation has now
+    bool Open(const std::string& cachePath, SourceFile& source, const Animation& animation,
+        float framesPerSecond, int boneCount = 100)
+    {
+        if (!m_File.Open(cachePath))
+            return false;
+
+        BakedPoseHeader header;
+        if (m_File.GetSize() < sizeof(header))
+        {
+            m_File.Close();
+            return false;
+        }
+        memcpy(&header, m_File.GetData(), sizeof(header));
+
+        uint32_t sampling;
+        uint64_t samplingHash;
+        GetSampling(animation, sampling, samplingHash);
+        int expectedFrames = std::max(2, (int)std::ceil(header.duration * framesPerSecond / animation.GetTicksPerSecond()) + 1);
+        uint64_t frameBytes = (uint64_t)header.frameCount * header.boneCount * sizeof(Affine3x4);
+        if (memcmp(header.magic, "HBPT", 4) != 0 ||
+            header.version != VERSION ||
+            header.sampling != sampling ||
+            header.samplingHash != samplingHash ||
+            header.skinHash != HashSkin(animation) ||
+            !source.IsCurrent(header.source) ||
+            (int)header.boneCount != boneCount ||
+            (int)header.frameCount != expectedFrames ||
+            header.frameOffset % alignof(Affine3x4) != 0 ||
+            header.frameOffset + frameBytes > m_File.GetSize())
+        {
+            std::cout << "Baked pose cache " << cachePath << " is stale, rebaking" << std::endl;
+            m_File.Close();
+            return false;
+        }
+
+        m_Storage.clear();
+        m_Storage.shrink_to_fit();
+        m_Frames = (const Affine3x4*)(m_File.GetData() + header.frameOffset);
+        m_FrameCount = (int)header.frameCount;
+        m_BoneCount = (int)header.boneCount;
+        m_FramesPerTick = header.framesPerTick;
+        m_Duration = header.duration;
+        m_Sampling = header.sampling;
+        m_SamplingHash = header.samplingHash;
+        m_SkinHash = header.skinHash;
+        return true;
+    }
+
+    bool Write(const std::string& cachePath, SourceFile& source) const
+    {
+        BakedPoseHeader header = {};
+        memcpy(header.magic, "HBPT", 4);
+        header.version = VERSION;
+        if (!source.Stamp(header.source))
+            return false;
+        header.skinHash = m_SkinHash;
+        header.sampling = m_Sampling;
+        header.samplingHash = m_SamplingHash;
+        header.frameCount = (uint32_t)m_FrameCount;
+        header.boneCount = (uint32_t)m_BoneCount;
+        header.framesPerTick = m_FramesPerTick;
+        header.duration = m_Duration;
+        header.frameOffset = sizeof(BakedPoseHeader);
+
+        std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "Failed to write baked pose cache " << cachePath << std::endl;
+            return false;
+        }
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)m_Frames, GetMemoryUsage());
+        return (bool)out;
+    }
+
+    inline void SetInterpolate(bool interpolate) { m_Interpolate = interpolate; }
+    inline const Affine3x4* GetFrame(int frame) const { return m_Frames + (size_t)frame * m_BoneCount; }
+    inline bool IsBuilt() const { return m_Frames != nullptr; }
+    inline int GetFrameCount() const { return m_FrameCount; }
+    inline int GetBoneCount() const { return m_BoneCount; }
+
+    size_t GetMemoryUsage() const
+    {
+        return (size_t)m_FrameCount * m_BoneCount * sizeof(Affine3x4);
+    }
+
+private:
+    // Mirrors the order EvaluateAnimationPose picks a representation in
+    static void GetSampling(const Animation& animation, uint32_t& outSampling, uint64_t& outHash)
+    {
+        if (animation.GetResampledClip().IsBuilt())
+        {
+            outSampling = BAKED_FROM_RESAMPLED;
+            outHash = animation.GetResampledClip().GetContentHash();
+        }
+        else if (animation.GetCompressedClip().IsBuilt())
+        {
+            outSampling = BAKED_FROM_COMPRESSED;
+            outHash = animation.GetCompressedClip().GetContentHash();
+        }
+        else
+        {
+            outSampling = BAKED_FROM_KEYS;
+            outHash = 0;
+        }
+    }
+
+    // The palette slots and offset matrices the baked frames were built with
+    static uint64_t HashSkin(const Animation& animation)
+    {
+        uint64_t hash = HashBytes(nullptr, 0);
+        for (const auto& entry : animation.GetBoneIDMap())
+        {
+            hash = HashBytes((const unsigned char*)entry.first.data(), entry.first.size(), hash);
+            hash = HashBytes((const unsigned char*)&entry.second.id, sizeof(entry.second.id), hash);
+            const glm::mat4& offset = entry.second.offset;
+            for (int c = 0; c < 4; c++)
+                for (int r = 0; r < 4; r++)
+                    hash = HashBytes((const unsigned char*)&offset[c][r], sizeof(float), hash);
+        }
+        return hash;
+    }
+
+    std::vector<Affine3x4> m_Storage;
+    const Affine3x4* m_Frames = nullptr;   // m_Storage or the mapped cache
+    MappedFile m_File;
+    int m_FrameCount = 0;
+    int m_BoneCount = 0;
+    float m_FramesPerTick = 0.0f;
+    float m_Duration = 0.0f;
+    bool m_Interpolate = true;
+    uint32_t m_Sampling = BAKED_FROM_KEYS;
+    uint64_t m_SamplingHash = 0;
+    uint64_t m_SkinHash = 0;
+};
+
+// Maps the baked pose cache of a clip, baking and writing it first when it is
+// missing or stale
+inline void LoadBakedPoses(const Animation& animation, SourceFile& source,
+    float framesPerSecond, BakedPoseTable& table)
+{
+    std::string cachePath = source.GetPath() + ".poses";
+    if (table.Open(cachePath, source, animation, framesPerSecond))
+        return;
+
+    table.Bake(animation, framesPerSecond);
+    table.Write(cachePath, source);
+}
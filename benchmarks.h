@@ -0,0 +1,645 @@
+#pragma once
+
+/* Timings of the fast paths against the code they replaced, run with
+   --benchmark [name ...]; no names runs them all. The synthetic ones need no window
+   or assets and run straight away. The rest use the shipped models and clips, so
+   main loads those in a hidden window, runs them and exits before the first frame.
+   Each benchmark prints one line per case and flags results that disagree. */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <learnopengl/model_animation.h>
+#include <learnopengl/animator.h>
+#include <learnopengl/crowd_animator.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/collision_mesh.h>
+#include <learnopengl/collision_bvh.h>
+#include <learnopengl/collision_grid.h>
+#include <learnopengl/collision_broadphase.h>
+#include <learnopengl/collision_batch.h>
+#include <learnopengl/map_collision.h>
+
+// Game constants the benchmarks reproduce, filled in by main
+struct BenchmarkSettings
+{
+    float playerRadius;  // wall test sphere
+    float walkSpeed;
+    float groundHeight;  // floor probe radius
+    float gridCellSize;
+    float resampleRate;  // samples per second
+};
+
+// Seconds on a steady clock; GLFW's timer is not running before the window exists
+inline double BenchmarkClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Times updates of a crowd of instances playing the clips, placed like main's crowd,
+// on 1, 2, 4, ... threads up to the hardware thread count
+inline void BenchmarkCrowd(Animation* const* clips, int clipCount, int instances)
+{
+    const int UPDATES = 50;
+    CrowdAnimator crowd;
+    for (int i = 0; i < instances; i++)
+    {
+        Animation* clip = clips[i % clipCount];
+        crowd.AddInstance(clip, fmod(i * 7.31f, clip->GetDuration()), 0.8f + 0.05f * (i % 8));
+    }
+
+    const float dt = 1.0f / 60.0f;
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int threads = 1; ; threads = std::min(threads * 2, maxThreads))
+    {
+        ThreadPool pool(threads);
+        crowd.Update(dt, &pool); // warm up per-thread scratch
+
+        double start = BenchmarkClock();
+        for (int i = 0; i < UPDATES; i++)
+            crowd.Update(dt, &pool);
+        double ms = (BenchmarkClock() - start) * 1000.0 / UPDATES;
+
+        std::cout << "Crowd benchmark: " << threads << " threads, " << ms << " ms per update, "
+            << crowd.GetInstanceCount() / ms << " instances/ms" << std::endl;
+        if (threads == maxThreads)
+            break;
+    }
+}
+
+inline float BenchmarkTerrainHeight(float x, float z)
+{
+    return std::sin(x * 0.3f) * std::cos(z * 0.2f) * 2.0f;
+}
+
+// Rolling heightfield of side x side quads (two triangles each, one unit wide) from
+// the origin along +X and +Z, standing in for a large outdoor level
+inline void BuildBenchmarkTerrain(CollisionMesh& mesh, int side)
+{
+    auto point = [](int x, int z)
+        {
+            return glm::vec3((float)x, BenchmarkTerrainHeight((float)x, (float)z), (float)z);
+        };
+
+    mesh.Resize((size_t)side * side * 2);
+    size_t t = 0;
+    for (int z = 0; z < side; z++)
+    {
+        for (int x = 0; x < side; x++)
+        {
+            mesh.SetTriangle(t++, point(x, z), point(x, z + 1), point(x + 1, z + 1));
+            mesh.SetTriangle(t++, point(x, z), point(x + 1, z + 1), point(x + 1, z));
+        }
+    }
+}
+
+// Player-sized sphere tests through the BVH and through a scan of every triangle,
+// as CheckMapCollision did before the BVH, on terrains of about 10k, 100k and 1M triangles
+inline void BenchmarkCollisionBVH(const BenchmarkSettings& settings)
+{
+    const int sides[] = { 71, 224, 708 };
+    for (int side : sides)
+    {
+        CollisionMesh mesh;
+        BuildBenchmarkTerrain(mesh, side);
+
+        double buildStart = BenchmarkClock();
+        CollisionBVH bvh(mesh);
+        double buildMs = (BenchmarkClock() - buildStart) * 1000.0;
+
+        // spheres scattered just above and below the surface, so about half touch it
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> across(0.0f, (float)side);
+        std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+        std::vector<glm::vec3> queries(10000);
+        for (glm::vec3& q : queries)
+        {
+            q.x = across(rng);
+            q.z = across(rng);
+            q.y = BenchmarkTerrainHeight(q.x, q.z) + offset(rng);
+        }
+
+        int bvhHits = 0;
+        double bvhStart = BenchmarkClock();
+        for (const glm::vec3& q : queries)
+            bvhHits += CheckMapCollision(q, settings.playerRadius, mesh, bvh) ? 1 : 0;
+        double bvhUs = (BenchmarkClock() - bvhStart) * 1e6 / queries.size();
+
+        // the scan is linear in the map, so it gets fewer queries on the larger ones
+        size_t triangleCount = mesh.GetTriangleCount();
+        size_t scanQueries = std::min(queries.size(), std::max<size_t>(20, 20000000 / triangleCount));
+        int scanHits = 0, scanBvhHits = 0;
+        double scanStart = BenchmarkClock();
+        for (size_t q = 0; q < scanQueries; q++)
+        {
+            glm::vec3 closest;
+            for (size_t i = 0; i < triangleCount; i++)
+            {
+                if (TestSphereTriangleEdges(queries[q], settings.playerRadius, mesh.GetA(i), mesh.GetAB(i), mesh.GetAC(i), closest))
+                {
+                    scanHits++;
+                    break;
+                }
+            }
+        }
+        double scanUs = (BenchmarkClock() - scanStart) * 1e6 / scanQueries;
+        for (size_t q = 0; q < scanQueries; q++)
+            scanBvhHits += CheckMapCollision(queries[q], settings.playerRadius, mesh, bvh) ? 1 : 0;
+
+        std::cout << "Collision BVH benchmark: " << triangleCount << " triangles, BVH built in " << buildMs
+            << " ms (" << bvh.GetMemoryUsage() / 1024 << " KB); " << bvhUs << " us per query with the BVH, "
+            << scanUs << " us with a linear scan (" << scanUs / bvhUs << "x), hits " << bvhHits << "/" << queries.size()
+            << (scanHits == scanBvhHits ? "" : ", SCAN AND BVH DISAGREE") << std::endl;
+    }
+}
+
+// count points spread uniformly through the bounds of the mesh's triangles
+inline std::vector<glm::vec3> MakeBenchmarkQueries(const CollisionMesh& mesh, size_t count)
+{
+    glm::vec3 boundsMin = mesh.GetBoundsMin(0), boundsMax = mesh.GetBoundsMax(0);
+    for (size_t i = 1; i < mesh.GetTriangleCount(); i++)
+    {
+        boundsMin = glm::min(boundsMin, mesh.GetBoundsMin(i));
+        boundsMax = glm::max(boundsMax, mesh.GetBoundsMax(i));
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<glm::vec3> queries(count);
+    for (glm::vec3& q : queries)
+        q = boundsMin + (boundsMax - boundsMin) * glm::vec3(unit(rng), unit(rng), unit(rng));
+    return queries;
+}
+
+// Sphere tests against every map triangle, read once through the Model's indices into its
+// Vertex array and once from the CollisionMesh streams, so only the data layout differs
+inline void BenchmarkCollisionLayout(const Model& map, const CollisionMesh& mesh, const BenchmarkSettings& settings)
+{
+    size_t triangleCount = mesh.GetTriangleCount();
+    if (triangleCount == 0)
+        return;
+    std::vector<glm::vec3> queries = MakeBenchmarkQueries(mesh, 200);
+
+    int indexedHits = 0;
+    double indexedStart = BenchmarkClock();
+    for (const glm::vec3& q : queries)
+    {
+        glm::vec3 closest;
+        for (const auto& m : map.meshes)
+        {
+            const auto& verts = m.vertices;
+            const auto& idx = m.indices;
+            for (size_t i = 0; i + 2 < idx.size(); i += 3)
+            {
+                if (TestSphereTriangle(q, settings.playerRadius, verts[idx[i]].Position, verts[idx[i + 1]].Position,
+                    verts[idx[i + 2]].Position, closest))
+                    indexedHits++;
+            }
+        }
+    }
+    double indexedMs = (BenchmarkClock() - indexedStart) * 1000.0;
+
+    int streamHits = 0;
+    double streamStart = BenchmarkClock();
+    for (const glm::vec3& q : queries)
+    {
+        glm::vec3 closest;
+        for (size_t i = 0; i < triangleCount; i++)
+        {
+            if (mesh.TestSphere(i, q, settings.playerRadius, closest))
+                streamHits++;
+        }
+    }
+    double streamMs = (BenchmarkClock() - streamStart) * 1000.0;
+
+    double tests = (double)triangleCount * queries.size();
+    std::cout << "Collision layout benchmark: " << triangleCount << " triangles; indexed Vertex data "
+        << CollisionMesh::GetIndexedMemoryUsage(map) / 1024 << " KB, " << tests / indexedMs / 1000.0
+        << " M triangles/s; CollisionMesh " << mesh.GetMemoryUsage() / 1024 << " KB, "
+        << tests / streamMs / 1000.0 << " M triangles/s (" << indexedMs / streamMs << "x)"
+        << (indexedHits == streamHits ? "" : ", LAYOUTS DISAGREE") << std::endl;
+}
+
+// Replays a minute of walking at 60 fps over a 100k triangle terrain, pausing one second in
+// four, with the per-frame collision work of the game loop: a floor resolution and the four
+// wall tests of processInput. Once through the contact cache and once straight on the BVH.
+inline void BenchmarkContactCache(const BenchmarkSettings& settings)
+{
+    const int SIDE = 224;
+    const int FRAMES = 3600;
+    const float dt = 1.0f / 60.0f;
+
+    CollisionMesh mesh;
+    BuildBenchmarkTerrain(mesh, SIDE);
+    CollisionBVH bvh(mesh);
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> turn(-0.1f, 0.1f);
+    std::vector<glm::vec3> path(FRAMES);
+    float x = SIDE * 0.5f, z = SIDE * 0.5f, heading = 0.0f;
+    for (int f = 0; f < FRAMES; f++)
+    {
+        if ((f / 60) % 4 != 3)
+        {
+            heading += turn(rng);
+            x = glm::clamp(x + std::cos(heading) * settings.walkSpeed * dt, 2.0f, SIDE - 2.0f);
+            z = glm::clamp(z + std::sin(heading) * settings.walkSpeed * dt, 2.0f, SIDE - 2.0f);
+        }
+        path[f] = glm::vec3(x, BenchmarkTerrainHeight(x, z) + settings.groundHeight, z);
+    }
+
+    // floorY keeps the results live; both passes must land on the same floors
+    auto walk = [&](auto&& broadphaseFor, float& floorY)
+        {
+            floorY = 0.0f;
+            double start = BenchmarkClock();
+            for (int f = 1; f < FRAMES; f++)
+            {
+                float reach = settings.groundHeight + 2.0f * settings.walkSpeed * dt;
+                glm::vec3 sweepMin = glm::min(path[f - 1], path[f]) - glm::vec3(reach, 2.0f * settings.groundHeight, reach);
+                glm::vec3 sweepMax = glm::max(path[f - 1], path[f]) + glm::vec3(reach, 2.0f * settings.groundHeight, reach);
+                const auto& broadphase = broadphaseFor(sweepMin, sweepMax);
+
+                glm::vec3 position = path[f];
+                ResolveVerticalCollision(position, settings.groundHeight, mesh, broadphase, -1.0f);
+                floorY += position.y;
+
+                const glm::vec3 steps[] = { { settings.walkSpeed * dt, 0, 0 }, { -settings.walkSpeed * dt, 0, 0 }, { 0, 0, settings.walkSpeed * dt }, { 0, 0, -settings.walkSpeed * dt } };
+                for (const glm::vec3& step : steps)
+                    floorY += CheckMapCollision(position + step + glm::vec3(0.0f, 0.1f, 0.0f), settings.playerRadius, mesh, broadphase) ? 1.0f : 0.0f;
+            }
+            return (BenchmarkClock() - start) * 1e6 / (FRAMES - 1);
+        };
+
+    ContactCache cache;
+    float cachedFloorY, bvhFloorY;
+    double cachedUs = walk([&](const glm::vec3& sweepMin, const glm::vec3& sweepMax) -> const CollisionCandidates&
+        {
+            return cache.Update(bvh, sweepMin, sweepMax);
+        }, cachedFloorY);
+    double bvhUs = walk([&](const glm::vec3&, const glm::vec3&) -> const CollisionBVH&
+        {
+            return bvh;
+        }, bvhFloorY);
+
+    std::cout << "Contact cache benchmark: " << FRAMES << " frames over " << mesh.GetTriangleCount()
+        << " triangles, hit rate " << cache.GetHitRate() * 100.0f << "% (" << cache.GetMisses() << " gathers); "
+        << cachedUs << " us per frame cached, " << bvhUs << " us on the BVH, " << bvhUs - cachedUs << " us saved"
+        << (cachedFloorY == bvhFloorY ? "" : ", CACHED AND BVH RESULTS DISAGREE") << std::endl;
+}
+
+// Build time, memory and sphere query latency of the grid (at the settings' cell size) and
+// the BVH over mesh, and the query latency of a scan of every triangle. The BVH reorders mesh.
+inline void BenchmarkBroadphases(const char* name, CollisionMesh& mesh, const BenchmarkSettings& settings)
+{
+    size_t triangleCount = mesh.GetTriangleCount();
+    if (triangleCount == 0)
+        return;
+    std::vector<glm::vec3> queries = MakeBenchmarkQueries(mesh, 10000);
+
+    double start = BenchmarkClock();
+    CollisionBVH bvh(mesh);
+    double bvhBuildMs = (BenchmarkClock() - start) * 1000.0;
+
+    start = BenchmarkClock();
+    CollisionGrid grid(mesh, settings.gridCellSize);
+    double gridBuildMs = (BenchmarkClock() - start) * 1000.0;
+
+    int bvhHits = 0, gridHits = 0;
+    start = BenchmarkClock();
+    for (const glm::vec3& q : queries)
+        bvhHits += CheckMapCollision(q, settings.playerRadius, mesh, bvh) ? 1 : 0;
+    double bvhUs = (BenchmarkClock() - start) * 1e6 / queries.size();
+
+    start = BenchmarkClock();
+    for (const glm::vec3& q : queries)
+        gridHits += CheckMapCollision(q, settings.playerRadius, mesh, grid) ? 1 : 0;
+    double gridUs = (BenchmarkClock() - start) * 1e6 / queries.size();
+
+    size_t scanQueries = std::min(queries.size(), std::max<size_t>(20, 20000000 / triangleCount));
+    start = BenchmarkClock();
+    for (size_t q = 0; q < scanQueries; q++)
+    {
+        glm::vec3 closest;
+        for (size_t i = 0; i < triangleCount; i++)
+        {
+            if (mesh.TestSphere(i, queries[q], settings.playerRadius, closest))
+                break;
+        }
+    }
+    double scanUs = (BenchmarkClock() - start) * 1e6 / scanQueries;
+
+    std::cout << "Broadphase benchmark " << name << " (" << triangleCount << " triangles): grid "
+        << gridBuildMs << " ms build, " << grid.GetMemoryUsage() / 1024 << " KB (" << grid.GetEntryCount()
+        << " entries), " << gridUs << " us per query; BVH " << bvhBuildMs << " ms build, "
+        << bvh.GetMemoryUsage() / 1024 << " KB, " << bvhUs << " us per query; linear scan " << scanUs
+        << " us per query" << (gridHits == bvhHits ? "" : "; GRID AND BVH DISAGREE") << std::endl;
+}
+
+// The shipped map, copied so the loaded mesh keeps its BVH order, then 100k and 1M
+// triangle terrains
+inline void BenchmarkCollisionGrid(const CollisionMesh& mapMesh, const BenchmarkSettings& settings)
+{
+    CollisionMesh map;
+    map.Resize(mapMesh.GetTriangleCount());
+    for (size_t i = 0; i < mapMesh.GetTriangleCount(); i++)
+    {
+        glm::vec3 a = mapMesh.GetA(i);
+        map.SetTriangle(i, a, a + mapMesh.GetAB(i), a + mapMesh.GetAC(i));
+    }
+    BenchmarkBroadphases("Map.obj", map, settings);
+
+    const int sides[] = { 224, 708 };
+    for (int side : sides)
+    {
+        CollisionMesh terrain;
+        BuildBenchmarkTerrain(terrain, side);
+        BenchmarkBroadphases("terrain", terrain, settings);
+    }
+}
+
+// 10000 agents scattered through the map, walking in random directions and falling
+inline void BenchmarkAgentCollision(const CollisionMesh& mapMesh, const CollisionBVH& mapBVH,
+    const BenchmarkSettings& settings)
+{
+    const size_t AGENTS = 10000;
+    const int UPDATES = 20;
+    const float dt = 1.0f / 60.0f;
+    if (mapMesh.GetTriangleCount() == 0)
+        return;
+
+    std::vector<glm::vec3> centers = MakeBenchmarkQueries(mapMesh, AGENTS);
+    std::vector<float> radii(AGENTS, settings.playerRadius);
+    std::vector<glm::vec3> velocities(AGENTS);
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    for (glm::vec3& v : velocities)
+    {
+        float a = angle(rng);
+        v = glm::vec3(std::cos(a) * settings.walkSpeed, -1.0f, std::sin(a) * settings.walkSpeed);
+    }
+
+    // serial results, which every thread count has to reproduce
+    std::vector<AgentCollisionResult> expected(AGENTS), results(AGENTS);
+    ResolveAgents(mapMesh, mapBVH, centers.data(), radii.data(), velocities.data(), AGENTS, dt, expected.data());
+
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; ; threads = std::min(threads * 2, maxThreads))
+    {
+        ThreadPool pool(threads);
+        double start = BenchmarkClock();
+        for (int i = 0; i < UPDATES; i++)
+            ResolveAgents(mapMesh, mapBVH, centers.data(), radii.data(), velocities.data(), AGENTS, dt, results.data(), &pool);
+        double ms = (BenchmarkClock() - start) * 1000.0 / UPDATES;
+
+        bool matches = true;
+        for (size_t i = 0; i < AGENTS; i++)
+            matches = matches && results[i].position == expected[i].position && results[i].blocked == expected[i].blocked;
+
+        std::cout << "Agent collision benchmark: " << threads << " threads, " << ms << " ms per batch, "
+            << AGENTS / ms << " agents/ms" << (matches ? "" : ", RESULTS DIFFER FROM SERIAL") << std::endl;
+        if (threads == maxThreads)
+            break;
+    }
+}
+
+// Poses per second of each clip through EvaluateAnimationPose and through the recursive
+// Animator::CalculateBoneTransform, which looks every node up by name
+inline void BenchmarkPoseEvaluation(Animation* const* clips, const char* const* names, int count)
+{
+    const int POSES = 1000;
+    for (int i = 0; i < count; i++)
+    {
+        Animation& clip = *clips[i];
+        std::vector<BoneCursor> cursors;
+        PoseScratch scratch;
+        std::vector<glm::mat4> pose(100, glm::mat4(1.0f));
+
+        double start = BenchmarkClock();
+        for (int k = 0; k < POSES; k++)
+            EvaluateAnimationPose(clip, clip.GetDuration() * k / POSES, cursors, scratch, pose.data(), pose.size());
+        double compiledSeconds = BenchmarkClock() - start;
+
+        Animator animator(&clip);
+        start = BenchmarkClock();
+        for (int k = 0; k < POSES; k++)
+        {
+            animator.SetCurrentTime(clip.GetDuration() * k / POSES);
+            animator.CalculateBoneTransform(&clip.GetRootNode(), glm::mat4(1.0f));
+        }
+        double recursiveSeconds = BenchmarkClock() - start;
+
+        // both last evaluated the same time
+        animator.SwapPoseBuffers();
+        BoneMatrixView recursivePose = animator.GetBoneMatrices();
+        float maxDifference = 0.0f;
+        for (size_t b = 0; b < pose.size() && b < recursivePose.size(); b++)
+            for (int c = 0; c < 4; c++)
+                for (int r = 0; r < 4; r++)
+                    maxDifference = std::max(maxDifference, std::abs(pose[b][c][r] - recursivePose[b][c][r]));
+
+        std::cout << "Pose benchmark " << names[i] << ": compiled " << POSES / compiledSeconds << " poses/s, recursive "
+            << POSES / recursiveSeconds << " poses/s (" << recursiveSeconds / compiledSeconds << "x), max difference "
+            << maxDifference << std::endl;
+    }
+}
+
+// Key lookups per second on channels of 1000 and 10000 keys, played forwards at 60 fps and
+// wrapping to a loop key half way through like the jump clip: the scan from key 0 that
+// Bone used to do, a binary search per lookup, and FindKeyIndex with a kept cursor
+inline void BenchmarkKeyLookup()
+{
+    const int LOOKUPS = 100000;
+    const int keyCounts[] = { 1000, 10000 };
+    for (int keyCount : keyCounts)
+    {
+        std::vector<KeyPosition> keys(keyCount);
+        for (int k = 0; k < keyCount; k++)
+        {
+            keys[k].position = glm::vec3((float)k);
+            keys[k].timeStamp = (float)k;
+        }
+
+        float duration = (float)(keyCount - 1);
+        float loopKey = duration * 0.5f;
+        std::vector<float> times(LOOKUPS);
+        float time = 0.0f;
+        for (float& t : times)
+        {
+            time += 24.0f / 60.0f;
+            if (time >= duration)
+                time = loopKey;
+            t = time;
+        }
+
+        long scanSum = 0, searchSum = 0, cursorSum = 0;
+        double start = BenchmarkClock();
+        for (float t : times)
+        {
+            int index = 0;
+            while (index < keyCount - 2 && t >= keys[index + 1].timeStamp)
+                index++;
+            scanSum += index;
+        }
+        double scanSeconds = BenchmarkClock() - start;
+
+        start = BenchmarkClock();
+        for (float t : times)
+        {
+            int cursor = -1; // no cursor, so every lookup searches
+            searchSum += Bone::FindKeyIndex(keys, t, cursor);
+        }
+        double searchSeconds = BenchmarkClock() - start;
+
+        int cursor = 0;
+        start = BenchmarkClock();
+        for (float t : times)
+            cursorSum += Bone::FindKeyIndex(keys, t, cursor);
+        double cursorSeconds = BenchmarkClock() - start;
+
+        std::cout << "Key lookup benchmark " << keyCount << " keys: scan " << LOOKUPS / scanSeconds / 1e6
+            << " M lookups/s, binary search " << LOOKUPS / searchSeconds / 1e6 << " M lookups/s, cursor "
+            << LOOKUPS / cursorSeconds / 1e6 << " M lookups/s"
+            << (scanSum == searchSum && scanSum == cursorSum ? "" : ", LOOKUPS DISAGREE") << std::endl;
+    }
+}
+
+// Each clip's channels resampled at the settings' rate into a ResampledClip of its own,
+// against the Bone keys: memory of both and channels sampled per second with SampleAll
+// and with Bone::Sample on cursors
+inline void BenchmarkResampledClips(Animation* const* clips, const char* const* names, int count,
+    const BenchmarkSettings& settings)
+{
+    const int POSES = 2000;
+    for (int i = 0; i < count; i++)
+    {
+        const Animation& clip = *clips[i];
+        const std::vector<Bone>& bones = clip.GetBones();
+        ResampledClip resampled;
+        resampled.Build(bones, clip.GetDuration(), settings.resampleRate / clip.GetTicksPerSecond());
+
+        LocalPose pose;
+        pose.Resize((int)bones.size());
+        std::vector<BoneCursor> cursors(bones.size());
+        double start = BenchmarkClock();
+        for (int k = 0; k < POSES; k++)
+        {
+            float time = clip.GetDuration() * k / POSES;
+            for (size_t c = 0; c < bones.size(); c++)
+            {
+                glm::vec3 position, scale;
+                glm::quat rotation;
+                bones[c].Sample(time, cursors[c], position, rotation, scale);
+                pose.Set((int)c, position, rotation, scale);
+            }
+        }
+        double keySeconds = BenchmarkClock() - start;
+
+        start = BenchmarkClock();
+        for (int k = 0; k < POSES; k++)
+            resampled.SampleAll(clip.GetDuration() * k / POSES, pose);
+        double gridSeconds = BenchmarkClock() - start;
+
+        double channels = (double)POSES * bones.size();
+        std::cout << "Resampled clip benchmark " << names[i] << ": keys "
+            << ResampledClip::GetKeyframeMemoryUsage(bones) / 1024 << " KB, " << channels / keySeconds / 1e6
+            << " M channels/s; " << resampled.GetFrameCount() << " frames " << resampled.GetMemoryUsage() / 1024
+            << " KB, " << channels / gridSeconds / 1e6 << " M channels/s (" << keySeconds / gridSeconds << "x)" << std::endl;
+    }
+}
+
+struct BenchmarkInfo
+{
+    const char* name;
+    bool needsAssets;   // runs from main once the models and clips are loaded
+    const char* description;
+};
+
+static const BenchmarkInfo BENCHMARKS[] = {
+    { "collision-bvh", false, "BVH against a linear scan on 10k-1M triangle terrains" },
+    { "contact-cache", false, "a walk over a synthetic map with and without the contact cache" },
+    { "key-lookup", false, "key search on synthetic 1000 and 10000 key channels" },
+    { "collision-layout", true, "the map's triangles as CollisionMesh streams and as indexed Vertex data" },
+    { "collision-grid", true, "grid against BVH and linear scan on the map and synthetic maps" },
+    { "agent-collision", true, "batched agent collision on the map against thread count" },
+    { "pose-evaluation", true, "poses/s of each clip, compiled skeleton against the recursive walk" },
+    { "resampled-clips", true, "memory and sampling rate of each clip resampled against its keys" },
+    { "crowd", true, "crowd updates against thread count" },
+    { "shader-variants", true, "the map's vertex processing with the skinned and static shaders" },
+};
+
+// The benchmarks named on the command line
+class BenchmarkSelection
+{
+public:
+    // names[0, count) picks benchmarks by name, none picks all; false on an unknown name
+    bool Select(int count, char** names)
+    {
+        m_Selected.clear();
+        for (int i = 0; i < count; i++)
+        {
+            const BenchmarkInfo* info = Find(names[i]);
+            if (!info)
+            {
+                std::cout << "Unknown benchmark " << names[i] << "; the benchmarks are:" << std::endl;
+                for (const BenchmarkInfo& known : BENCHMARKS)
+                    std::cout << "  " << known.name << ": " << known.description << std::endl;
+                return false;
+            }
+            if (!Has(info->name))
+                m_Selected.push_back(info);
+        }
+
+        if (count == 0)
+            for (const BenchmarkInfo& info : BENCHMARKS)
+                m_Selected.push_back(&info);
+        return true;
+    }
+
+    inline bool IsActive() const { return !m_Selected.empty(); }
+
+    bool Has(const char* name) const
+    {
+        for (const BenchmarkInfo* info : m_Selected)
+            if (info->name == std::string(name))
+                return true;
+        return false;
+    }
+
+    bool NeedsAssets() const
+    {
+        for (const BenchmarkInfo* info : m_Selected)
+            if (info->needsAssets)
+                return true;
+        return false;
+    }
+
+private:
+    static const BenchmarkInfo* Find(const std::string& name)
+    {
+        for (const BenchmarkInfo& info : BENCHMARKS)
+            if (name == info.name)
+                return &info;
+        return nullptr;
+    }
+
+    std::vector<const BenchmarkInfo*> m_Selected;
+};
+
+// Runs the selected benchmarks that need no assets
+inline void RunSyntheticBenchmarks(const BenchmarkSelection& selection, const BenchmarkSettings& settings)
+{
+    if (selection.Has("collision-bvh"))
+        BenchmarkCollisionBVH(settings);
+    if (selection.Has("contact-cache"))
+        BenchmarkContactCache(settings);
+    if (selection.Has("key-lookup"))
+        BenchmarkKeyLookup();
+}
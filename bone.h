@@ -5,6 +5,7 @@
 #include <vector>
 #include <assimp/scene.h>
 #include <list>
+#include <algorithm>
 #include <glm/glm.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/quaternion.hpp>
@@ -28,6 +29,15 @@ struct KeyScale
 	float timeStamp;
 };
 
+// Last key segment sampled on each channel, kept per playing instance so
+// sequential playback does not search from key 0 every update
+struct BoneCursor
+{
+	int position = 0;
+	int rotation = 0;
+	int scale = 0;
+};
+
 class Bone
 {
 public:
@@ -72,111 +82,165 @@ public:
 		}
 	}
 	
+	// From keys read elsewhere, e.g. a binary animation cache
+	Bone(const std::string& name, int ID, std::vector<KeyPosition> positions,
+		std::vector<KeyRotation> rotations, std::vector<KeyScale> scales)
+		:
+		m_Positions(std::move(positions)),
+		m_Rotations(std::move(rotations)),
+		m_Scales(std::move(scales)),
+		m_LocalTransform(1.0f),
+		m_Name(name),
+		m_ID(ID)
+	{
+		m_NumPositions = (int)m_Positions.size();
+		m_NumRotations = (int)m_Rotations.size();
+		m_NumScalings = (int)m_Scales.size();
+	}
+	
 	void Update(float animationTime)
 	{
-		glm::vec3 tmp;
-		glm::quat tmpR;
-		glm::mat4 translation = InterpolatePosition(animationTime, tmp);
-		glm::mat4 rotation = InterpolateRotation(animationTime, tmpR);
-		glm::mat4 scale = InterpolateScaling(animationTime, tmp);
-		m_LocalTransform = translation * rotation * scale;
+		Update(animationTime, m_Cursor);
+	}
+
+	void Update(float animationTime, BoneCursor& cursor)
+	{
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+		Sample(animationTime, cursor, position, rotation, scale);
+		m_LocalTransform = glm::translate(glm::mat4(1.0f), position)
+			* glm::toMat4(rotation)
+			* glm::scale(glm::mat4(1.0f), scale);
 	}
+
+	// Samples the channel without touching the bone, so many instances can share it;
+	// each instance keeps its own cursor
+	void Sample(float animationTime, BoneCursor& cursor,
+		glm::vec3& position, glm::quat& rotation, glm::vec3& scale) const
+	{
+		position = SamplePosition(animationTime, cursor.position);
+		rotation = SampleRotation(animationTime, cursor.rotation);
+		scale = SampleScaling(animationTime, cursor.scale);
+	}
+
 	glm::mat4 GetLocalTransform() { return m_LocalTransform; }
 	std::string GetBoneName() const { return m_Name; }
 	int GetBoneID() { return m_ID; }
 
 
 
-	int GetPositionIndex(float animationTime)
+	int GetPositionIndex(float animationTime) const
 	{
-		for (int index = 0; index < m_NumPositions - 1; ++index)
-		{
-			if (animationTime < m_Positions[index + 1].timeStamp)
-				return index;
-		}
-		assert(0);
+		int cursor = 0;
+		return FindKeyIndex(m_Positions, animationTime, cursor);
 	}
 
-	int GetRotationIndex(float animationTime)
+	int GetRotationIndex(float animationTime) const
 	{
-		for (int index = 0; index < m_NumRotations - 1; ++index)
-		{
-			if (animationTime < m_Rotations[index + 1].timeStamp)
-				return index;
-		}
-		assert(0);
+		int cursor = 0;
+		return FindKeyIndex(m_Rotations, animationTime, cursor);
+	}
+
+	int GetScaleIndex(float animationTime) const
+	{
+		int cursor = 0;
+		return FindKeyIndex(m_Scales, animationTime, cursor);
 	}
 
-	int GetScaleIndex(float animationTime)
+	// Index of the key segment [index, index + 1] containing animationTime, clamped to
+	// the first and last segment. Sequential playback stays on the cursor's segment or
+	// steps to the next one in O(1); jumps (loop wrap, loop key, seeking) fall back
+	// to a binary search.
+	template <typename Key>
+	static int FindKeyIndex(const std::vector<Key>& keys, float animationTime, int& cursor)
 	{
-		for (int index = 0; index < m_NumScalings - 1; ++index)
+		int lastSegment = (int)keys.size() - 2;
+		if (lastSegment <= 0)
+			return 0;
+
+		if (cursor >= 0 && cursor <= lastSegment && animationTime >= keys[cursor].timeStamp)
 		{
-			if (animationTime < m_Scales[index + 1].timeStamp)
-				return index;
+			if (animationTime < keys[cursor + 1].timeStamp || cursor == lastSegment)
+				return cursor;
+			if (cursor + 1 == lastSegment || animationTime < keys[cursor + 2].timeStamp)
+				return ++cursor;
 		}
-		assert(0);
+
+		auto next = std::upper_bound(keys.begin() + 1, keys.end() - 1, animationTime,
+			[](float time, const Key& key) { return time < key.timeStamp; });
+		cursor = (int)(next - keys.begin()) - 1;
+		return cursor;
 	}
 
 
 //private:
 
-	float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime)
+	float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime) const
 	{
 		float scaleFactor = 0.0f;
 		float midWayLength = animationTime - lastTimeStamp;
 		float framesDiff = nextTimeStamp - lastTimeStamp;
 		scaleFactor = midWayLength / framesDiff;
-		return scaleFactor;
+		return glm::clamp(scaleFactor, 0.0f, 1.0f);
 	}
 
-	glm::mat4 InterpolatePosition(float animationTime, glm::vec3 &finalPos)
+	glm::vec3 SamplePosition(float animationTime, int& cursor) const
 	{
 		if (1 == m_NumPositions)
-			return glm::translate(glm::mat4(1.0f), m_Positions[0].position);
+			return m_Positions[0].position;
 
-		int p0Index = GetPositionIndex(animationTime);
+		int p0Index = FindKeyIndex(m_Positions, animationTime, cursor);
 		int p1Index = p0Index + 1;
 		float scaleFactor = GetScaleFactor(m_Positions[p0Index].timeStamp,
 			m_Positions[p1Index].timeStamp, animationTime);
-		glm::vec3 finalPosition = glm::mix(m_Positions[p0Index].position, m_Positions[p1Index].position
+		return glm::mix(m_Positions[p0Index].position, m_Positions[p1Index].position
 			, scaleFactor);
-		finalPos = finalPosition;
-		return glm::translate(glm::mat4(1.0f), finalPosition);
 	}
 
-	glm::mat4 InterpolateRotation(float animationTime, glm::quat &finalQuat)
+	glm::quat SampleRotation(float animationTime, int& cursor) const
 	{
 		if (1 == m_NumRotations)
-		{
-			auto rotation = glm::normalize(m_Rotations[0].orientation);
-			return glm::toMat4(rotation);
-		}
+			return glm::normalize(m_Rotations[0].orientation);
 
-		int p0Index = GetRotationIndex(animationTime);
+		int p0Index = FindKeyIndex(m_Rotations, animationTime, cursor);
 		int p1Index = p0Index + 1;
 		float scaleFactor = GetScaleFactor(m_Rotations[p0Index].timeStamp,
 			m_Rotations[p1Index].timeStamp, animationTime);
 		glm::quat finalRotation = glm::slerp(m_Rotations[p0Index].orientation, m_Rotations[p1Index].orientation
 			, scaleFactor);
-		finalRotation = glm::normalize(finalRotation);
-		finalQuat = finalRotation;
-		return glm::toMat4(finalRotation);
-
+		return glm::normalize(finalRotation);
 	}
 
-	glm::mat4 InterpolateScaling(float animationTime, glm::vec3 &finalScaling)
+	glm::vec3 SampleScaling(float animationTime, int& cursor) const
 	{
 		if (1 == m_NumScalings)
-			return glm::scale(glm::mat4(1.0f), m_Scales[0].scale);
+			return m_Scales[0].scale;
 
-		int p0Index = GetScaleIndex(animationTime);
+		int p0Index = FindKeyIndex(m_Scales, animationTime, cursor);
 		int p1Index = p0Index + 1;
 		float scaleFactor = GetScaleFactor(m_Scales[p0Index].timeStamp,
 			m_Scales[p1Index].timeStamp, animationTime);
-		glm::vec3 finalScale = glm::mix(m_Scales[p0Index].scale, m_Scales[p1Index].scale
+		return glm::mix(m_Scales[p0Index].scale, m_Scales[p1Index].scale
 			, scaleFactor);
-		finalScaling = finalScale;
-		return glm::scale(glm::mat4(1.0f), finalScale);
+	}
+
+	glm::mat4 InterpolatePosition(float animationTime, glm::vec3 &finalPos)
+	{
+		finalPos = SamplePosition(animationTime, m_Cursor.position);
+		return glm::translate(glm::mat4(1.0f), finalPos);
+	}
+
+	glm::mat4 InterpolateRotation(float animationTime, glm::quat &finalQuat)
+	{
+		finalQuat = SampleRotation(animationTime, m_Cursor.rotation);
+		return glm::toMat4(finalQuat);
+	}
+
+	glm::mat4 InterpolateScaling(float animationTime, glm::vec3 &finalScaling)
+	{
+		finalScaling = SampleScaling(animationTime, m_Cursor.scale);
+		return glm::scale(glm::mat4(1.0f), finalScaling);
 	}
 
 	std::vector<KeyPosition> m_Positions;
@@ -187,6 +251,7 @@ public:
 	int m_NumScalings;
 
 	glm::mat4 m_LocalTransform;
+	BoneCursor m_Cursor;
 	std::string m_Name;
 	int m_ID;
 };
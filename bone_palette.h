@@ -0,0 +1,60 @@
+#pragma once
+
+/* Skinning matrices in a uniform buffer shared by every program that declares the
+   BonePalette block. A frame's pose goes up in one glBufferSubData covering only the
+   bones the model uses, instead of one uniform lookup and call per matrix. */
+
+#include <algorithm>
+#include <iostream>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class BonePalette
+{
+public:
+    static const int MAX_BONES = 100;           // matches the block in anim_model.vs
+    static const unsigned int BINDING = 0;      // uniform buffer binding point
+
+    BonePalette() = default;
+    BonePalette(const BonePalette&) = delete;
+    BonePalette& operator=(const BonePalette&) = delete;
+
+    // Creates the buffer, filled with identity matrices; needs a current GL context
+    void Create()
+    {
+        // std140 lays a mat4 out as four vec4 columns, the same as glm::mat4
+        glm::mat4 identity[MAX_BONES];
+        std::fill(identity, identity + MAX_BONES, glm::mat4(1.0f));
+
+        glGenBuffers(1, &m_Buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(identity), identity, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_Buffer);
+    }
+
+    // Points a program's BonePalette block at the buffer; once after linking
+    bool Attach(unsigned int program)
+    {
+        unsigned int blockIndex = glGetUniformBlockIndex(program, "BonePalette");
+        if (blockIndex == GL_INVALID_INDEX)
+        {
+            std::cout << "Shader program " << program << " has no BonePalette block" << std::endl;
+            return false;
+        }
+        glUniformBlockBinding(program, blockIndex, BINDING);
+        return true;
+    }
+
+    // Uploads matrices[0, count); bones past count keep their previous contents
+    void Upload(const glm::mat4* matrices, size_t count)
+    {
+        count = std::min(count, (size_t)MAX_BONES);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(glm::mat4), matrices);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+private:
+    unsigned int m_Buffer = 0;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+/* Collision for many agents (NPCs, projectiles) against the shared, read-only map
+   data. Each agent tries its horizontal move, is blocked by walls like the player's
+   TryMove, then falls and snaps to the floor like ResolveVerticalCollision.
+   Agents are independent, so the batch is split across a ThreadPool; results are
+   written at the agent's input index. */
+
+#include <glm/glm.hpp>
+#include <learnopengl/map_collision.h>
+#include <learnopengl/thread_pool.h>
+
+struct AgentCollisionResult
+{
+    glm::vec3 position;
+    glm::vec3 velocity;
+    bool blocked;  // horizontal move rejected by a wall
+    bool onGround;
+};
+
+inline AgentCollisionResult ResolveAgent(const CollisionMesh& mesh, const CollisionBVH& bvh,
+    const glm::vec3& center, float radius, const glm::vec3& velocity, float dt)
+{
+    AgentCollisionResult result;
+    result.position = center;
+    result.velocity = velocity;
+
+    glm::vec3 attempt = center + glm::vec3(velocity.x, 0.0f, velocity.z) * dt;
+    result.blocked = CheckMapCollision(attempt, radius, mesh, bvh);
+    if (!result.blocked)
+        result.position = attempt;
+
+    result.position.y += velocity.y * dt;
+    result.velocity.y = ResolveVerticalCollision(result.position, radius, mesh, bvh, velocity.y);
+    result.onGround = result.velocity.y == 0.0f;
+    return result;
+}
+
+// pool may be null to run on the calling thread
+inline void ResolveAgents(const CollisionMesh& mesh, const CollisionBVH& bvh,
+    const glm::vec3* centers, const float* radii, const glm::vec3* velocities, size_t count,
+    float dt, AgentCollisionResult* outResults, ThreadPool* pool = nullptr)
+{
+    auto resolveRange = [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+                outResults[i] = ResolveAgent(mesh, bvh, centers[i], radii[i], velocities[i], dt);
+        };
+
+    const size_t AGENTS_PER_JOB = 16;
+    if (pool)
+        pool->ParallelFor(count, AGENTS_PER_JOB, resolveRange);
+    else
+        resolveRange(0, count);
+}
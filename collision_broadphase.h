@@ -0,0 +1,129 @@
+#pragma once
+
+/* Per-frame candidate set: the BVH leaves overlapping the player's swept box are
+   gathered once, then every collision test of that frame only visits them.
+   Exposes the same QuerySphereLeaves interface as CollisionBVH. */
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <learnopengl/collision_bvh.h>
+
+class CollisionCandidates
+{
+public:
+    struct Range
+    {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        int first;
+        int count;
+    };
+
+    void Gather(const CollisionBVH& bvh, const glm::vec3& boxMin, const glm::vec3& boxMax)
+    {
+        m_BVH = &bvh;
+        m_BoundsMin = boxMin;
+        m_BoundsMax = boxMax;
+        m_Ranges.clear();
+        m_TriangleCount = 0;
+        m_TrianglesTested = 0;
+
+        bvh.QueryAABBNodes(boxMin, boxMax, [&](const BVHNode& leaf)
+            {
+                Range range;
+                range.boundsMin = leaf.boundsMin;
+                range.boundsMax = leaf.boundsMax;
+                range.first = leaf.leftFirst;
+                range.count = leaf.count;
+                m_Ranges.push_back(range);
+                m_TriangleCount += leaf.count;
+                return false;
+            });
+    }
+
+    // Spheres that leave the gathered box fall back to a full BVH query
+    template <typename Fn>
+    bool QuerySphereLeaves(const glm::vec3& center, float radius, Fn&& fn) const
+    {
+        if (!Contains(center - glm::vec3(radius), center + glm::vec3(radius)))
+        {
+            return m_BVH && m_BVH->QuerySphereLeaves(center, radius, [&](int first, int count)
+                {
+                    m_TrianglesTested += count;
+                    return fn(first, count);
+                });
+        }
+
+        for (const Range& range : m_Ranges)
+        {
+            if (!SphereOverlapsAABB(center, radius, range.boundsMin, range.boundsMax))
+                continue;
+
+            m_TrianglesTested += range.count;
+            if (fn(range.first, range.count))
+                return true;
+        }
+        return false;
+    }
+
+    inline bool Contains(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+    {
+        return m_BVH &&
+               boxMin.x >= m_BoundsMin.x && boxMax.x <= m_BoundsMax.x &&
+               boxMin.y >= m_BoundsMin.y && boxMax.y <= m_BoundsMax.y &&
+               boxMin.z >= m_BoundsMin.z && boxMax.z <= m_BoundsMax.z;
+    }
+
+    inline void ResetStats() { m_TrianglesTested = 0; }
+    inline int GetTriangleCount() const { return m_TriangleCount; }
+    inline int GetTrianglesTested() const { return m_TrianglesTested; }
+
+private:
+    std::vector<Range> m_Ranges;
+    glm::vec3 m_BoundsMin;
+    glm::vec3 m_BoundsMax;
+    const CollisionBVH* m_BVH = nullptr;
+    int m_TriangleCount = 0;
+    mutable int m_TrianglesTested = 0;
+};
+
+/* Temporal-coherence cache: keeps the candidate set of a region around the last
+   contact and reuses it while the player's swept box stays inside, so walking
+   across the same floor skips the BVH entirely. Only leaving the region costs a
+   new gather. */
+class ContactCache
+{
+public:
+    ContactCache(float margin = 2.0f)
+        : m_Margin(margin)
+    {
+    }
+
+    const CollisionCandidates& Update(const CollisionBVH& bvh, const glm::vec3& sweepMin, const glm::vec3& sweepMax)
+    {
+        if (m_Candidates.Contains(sweepMin, sweepMax))
+        {
+            m_Hits++;
+            m_Candidates.ResetStats();
+        }
+        else
+        {
+            m_Misses++;
+            m_Candidates.Gather(bvh, sweepMin - glm::vec3(m_Margin), sweepMax + glm::vec3(m_Margin));
+        }
+        return m_Candidates;
+    }
+
+    inline void Invalidate() { m_Candidates = CollisionCandidates(); }
+    inline void SetMargin(float margin) { m_Margin = margin; }
+    inline const CollisionCandidates& GetCandidates() const { return m_Candidates; }
+    inline long GetHits() const { return m_Hits; }
+    inline long GetMisses() const { return m_Misses; }
+    inline float GetHitRate() const { return m_Hits + m_Misses > 0 ? (float)m_Hits / (m_Hits + m_Misses) : 0.0f; }
+
+private:
+    CollisionCandidates m_Candidates;
+    float m_Margin;
+    long m_Hits = 0;
+    long m_Misses = 0;
+};
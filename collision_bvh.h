@@ -0,0 +1,350 @@
+#pragma once
+
+/* Bounding volume hierarchy over the map triangles, built once after the map is loaded.
+   Building reorders the CollisionMesh so every leaf covers a contiguous triangle range.
+   Like the mesh, the node array is either owned or viewed in place from a cache file. */
+
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <learnopengl/collision_mesh.h>
+
+struct BVHNode
+{
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    int leftFirst; // first child for interior nodes, first triangle for leaves
+    int count;     // number of triangles, 0 for interior nodes
+};
+
+inline bool SphereOverlapsAABB(const glm::vec3& center, float radius,
+    const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    glm::vec3 q = glm::clamp(center, boxMin, boxMax);
+    glm::vec3 d = center - q;
+    return glm::dot(d, d) <= radius * radius;
+}
+
+inline bool AABBOverlapsAABB(const glm::vec3& aMin, const glm::vec3& aMax,
+    const glm::vec3& bMin, const glm::vec3& bMax)
+{
+    return aMin.x <= bMax.x && aMax.x >= bMin.x &&
+           aMin.y <= bMax.y && aMax.y >= bMin.y &&
+           aMin.z <= bMax.z && aMax.z >= bMin.z;
+}
+
+// Slab test of the ray segment orig + t * dir, t in [0, tMax]
+inline bool RayOverlapsAABB(const glm::vec3& orig, const glm::vec3& dir, float tMax,
+    const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    float tNear = 0.0f;
+    float tFar = tMax;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (dir[axis] == 0.0f)
+        {
+            if (orig[axis] < boxMin[axis] || orig[axis] > boxMax[axis])
+                return false;
+            continue;
+        }
+
+        float inv = 1.0f / dir[axis];
+        float t0 = (boxMin[axis] - orig[axis]) * inv;
+        float t1 = (boxMax[axis] - orig[axis]) * inv;
+        if (t0 > t1) std::swap(t0, t1);
+
+        tNear = std::max(tNear, t0);
+        tFar = std::min(tFar, t1);
+        if (tNear > tFar)
+            return false;
+    }
+
+    return true;
+}
+
+class CollisionBVH
+{
+public:
+    static const int MAX_LEAF_TRIANGLES = 4;
+    static const int MAX_DEPTH = 64;
+
+    CollisionBVH() = default;
+
+    CollisionBVH(CollisionMesh& mesh)
+    {
+        Build(mesh);
+    }
+
+    CollisionBVH(const CollisionBVH&) = delete;
+    CollisionBVH& operator=(const CollisionBVH&) = delete;
+    CollisionBVH(CollisionBVH&&) = default;
+    CollisionBVH& operator=(CollisionBVH&&) = default;
+
+    void Build(CollisionMesh& mesh)
+    {
+        m_Nodes.clear();
+        m_NodeData = nullptr;
+        m_NodeCount = 0;
+        m_Order.clear();
+        m_Mesh = &mesh;
+
+        int count = (int)mesh.GetTriangleCount();
+        if (count == 0)
+            return;
+
+        m_Order.resize(count);
+        for (int i = 0; i < count; i++)
+            m_Order[i] = i;
+
+        m_Nodes.reserve(2 * count / MAX_LEAF_TRIANGLES + 1);
+
+        BVHNode root;
+        root.leftFirst = 0;
+        root.count = count;
+        m_Nodes.push_back(root);
+        UpdateBounds(0);
+        Subdivide(0, 0);
+
+        mesh.Reorder(m_Order);
+        m_Order.clear();
+        m_Order.shrink_to_fit();
+        m_Mesh = nullptr;
+
+        m_NodeData = m_Nodes.data();
+        m_NodeCount = m_Nodes.size();
+    }
+
+    // Uses count nodes at data without copying; data must outlive the tree
+    void View(const BVHNode* data, size_t count)
+    {
+        m_Nodes.clear();
+        m_Nodes.shrink_to_fit();
+        m_NodeData = data;
+        m_NodeCount = count;
+    }
+
+    // Calls fn(first, count) for every leaf whose bounds overlap the sphere; the leaf
+    // covers triangles [first, first + count) of the mesh the tree was built from.
+    // fn returns true to stop the traversal early; the query then returns true.
+    template <typename Fn>
+    bool QuerySphereLeaves(const glm::vec3& center, float radius, Fn&& fn) const
+    {
+        return Traverse([&](const BVHNode& node)
+            {
+                return SphereOverlapsAABB(center, radius, node.boundsMin, node.boundsMax);
+            },
+            [&](const BVHNode& leaf)
+            {
+                return fn(leaf.leftFirst, leaf.count);
+            });
+    }
+
+    template <typename Fn>
+    bool QueryAABBLeaves(const glm::vec3& boxMin, const glm::vec3& boxMax, Fn&& fn) const
+    {
+        return QueryAABBNodes(boxMin, boxMax, [&](const BVHNode& leaf)
+            {
+                return fn(leaf.leftFirst, leaf.count);
+            });
+    }
+
+    // Leaves hit by the ray segment [0, tMax]. tMax is re-read at every node, so fn
+    // can shorten it as closer hits are found to prune the rest of the traversal.
+    template <typename Fn>
+    bool QueryRayLeaves(const glm::vec3& orig, const glm::vec3& dir, const float& tMax, Fn&& fn) const
+    {
+        return Traverse([&](const BVHNode& node)
+            {
+                return RayOverlapsAABB(orig, dir, tMax, node.boundsMin, node.boundsMax);
+            },
+            [&](const BVHNode& leaf)
+            {
+                return fn(leaf.leftFirst, leaf.count);
+            });
+    }
+
+    // Calls fn(leafNode) so callers can keep the leaf bounds as well
+    template <typename Fn>
+    bool QueryAABBNodes(const glm::vec3& boxMin, const glm::vec3& boxMax, Fn&& fn) const
+    {
+        return Traverse([&](const BVHNode& node)
+            {
+                return AABBOverlapsAABB(boxMin, boxMax, node.boundsMin, node.boundsMax);
+            }, fn);
+    }
+
+    // Same as above, but calls fn(triangleIndex) once per triangle
+    template <typename Fn>
+    bool QuerySphere(const glm::vec3& center, float radius, Fn&& fn) const
+    {
+        return QuerySphereLeaves(center, radius, [&](int first, int count)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    if (fn(first + i))
+                        return true;
+                }
+                return false;
+            });
+    }
+
+    template <typename Fn>
+    bool QueryAABB(const glm::vec3& boxMin, const glm::vec3& boxMax, Fn&& fn) const
+    {
+        return QueryAABBLeaves(boxMin, boxMax, [&](int first, int count)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    if (fn(first + i))
+                        return true;
+                }
+                return false;
+            });
+    }
+
+    // True when count nodes at data form a tree Build could have written over
+    // triangleCount triangles: every node below the root is the child of exactly one
+    // earlier node, leaves hold 1..MAX_LEAF_TRIANGLES triangles inside the mesh, and
+    // no leaf is deeper than the traversal stack allows. Run on mapped caches before
+    // View, in one pass over the array.
+    static bool Validate(const BVHNode* data, size_t count, size_t triangleCount)
+    {
+        if (count == 0)
+            return false;
+
+        std::vector<int> depths(count, -1);
+        depths[0] = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const BVHNode& node = data[i];
+            if (depths[i] < 0)
+                return false;
+
+            if (node.count > 0)
+            {
+                if (node.count > MAX_LEAF_TRIANGLES || node.leftFirst < 0 ||
+                    (size_t)node.leftFirst + node.count > triangleCount)
+                    return false;
+            }
+            else
+            {
+                // children come after their parent, so the walk cannot loop
+                if (node.count < 0 || node.leftFirst <= 0 || (size_t)node.leftFirst <= i ||
+                    (size_t)node.leftFirst + 1 >= count ||
+                    depths[node.leftFirst] >= 0 || depths[node.leftFirst + 1] >= 0 ||
+                    depths[i] + 1 > MAX_DEPTH - 2)
+                    return false;
+                depths[node.leftFirst] = depths[i] + 1;
+                depths[node.leftFirst + 1] = depths[i] + 1;
+            }
+        }
+        return true;
+    }
+
+    inline const BVHNode* GetNodes() const { return m_NodeData; }
+    inline size_t GetNodeCount() const { return m_NodeCount; }
+    inline size_t GetMemoryUsage() const { return m_NodeCount * sizeof(BVHNode); }
+
+private:
+    template <typename Overlap, typename Fn>
+    bool Traverse(Overlap&& overlaps, Fn&& fn) const
+    {
+        if (m_NodeCount == 0)
+            return false;
+
+        int stack[MAX_DEPTH];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0)
+        {
+            const BVHNode& node = m_NodeData[stack[--top]];
+            if (!overlaps(node))
+                continue;
+
+            if (node.count > 0)
+            {
+                if (fn(node))
+                    return true;
+            }
+            else
+            {
+                stack[top++] = node.leftFirst + 1;
+                stack[top++] = node.leftFirst;
+            }
+        }
+
+        return false;
+    }
+
+    void UpdateBounds(int nodeIndex)
+    {
+        BVHNode& node = m_Nodes[nodeIndex];
+        node.boundsMin = glm::vec3(1e30f);
+        node.boundsMax = glm::vec3(-1e30f);
+
+        for (int i = 0; i < node.count; i++)
+        {
+            int tri = m_Order[node.leftFirst + i];
+            node.boundsMin = glm::min(node.boundsMin, m_Mesh->GetBoundsMin(tri));
+            node.boundsMax = glm::max(node.boundsMax, m_Mesh->GetBoundsMax(tri));
+        }
+    }
+
+    void Subdivide(int nodeIndex, int depth)
+    {
+        // the traversal stack holds at most one pending sibling per level
+        if (m_Nodes[nodeIndex].count <= MAX_LEAF_TRIANGLES || depth >= MAX_DEPTH - 2)
+            return;
+
+        int first = m_Nodes[nodeIndex].leftFirst;
+        int count = m_Nodes[nodeIndex].count;
+
+        glm::vec3 extent = m_Nodes[nodeIndex].boundsMax - m_Nodes[nodeIndex].boundsMin;
+        int axis = 0;
+        if (extent.y > extent.x) axis = 1;
+        if (extent.z > extent[axis]) axis = 2;
+
+        // median split on the longest axis keeps the tree balanced on uneven levels
+        int half = count / 2;
+        const CollisionMesh& mesh = *m_Mesh;
+        auto begin = m_Order.begin() + first;
+        std::nth_element(begin, begin + half, begin + count,
+            [axis, &mesh](int l, int r)
+            {
+                return (mesh.GetBoundsMin(l)[axis] + mesh.GetBoundsMax(l)[axis]) <
+                       (mesh.GetBoundsMin(r)[axis] + mesh.GetBoundsMax(r)[axis]);
+            }
+        );
+
+        int leftIndex = (int)m_Nodes.size();
+
+        BVHNode left;
+        left.leftFirst = first;
+        left.count = half;
+
+        BVHNode right;
+        right.leftFirst = first + half;
+        right.count = count - half;
+
+        m_Nodes.push_back(left);
+        m_Nodes.push_back(right);
+
+        m_Nodes[nodeIndex].leftFirst = leftIndex;
+        m_Nodes[nodeIndex].count = 0;
+
+        UpdateBounds(leftIndex);
+        UpdateBounds(leftIndex + 1);
+        Subdivide(leftIndex, depth + 1);
+        Subdivide(leftIndex + 1, depth + 1);
+    }
+
+    std::vector<BVHNode> m_Nodes;
+    const BVHNode* m_NodeData = nullptr;
+    size_t m_NodeCount = 0;
+
+    // build-time only
+    std::vector<int> m_Order;
+    CollisionMesh* m_Mesh = nullptr;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+/* Baked collision data on disk: a versioned header followed by the CollisionMesh
+   streams and the BVH node array, exactly as they sit in memory. The first launch
+   writes it next to the source asset; later launches map the file and point the
+   mesh and BVH at it, so startup costs an mmap instead of a full index build.
+
+   Layout:
+     CollisionCacheHeader
+     float streams[CollisionMesh::STREAM_COUNT][triangleCount]
+     BVHNode nodes[nodeCount]                      (at nodeOffset) */
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/collision_mesh.h>
+#include <learnopengl/collision_bvh.h>
+
+struct CollisionCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    SourceStamp source;
+    uint32_t triangleCount;
+    uint32_t nodeCount;
+    uint32_t streamCount;
+    uint32_t nodeSize;
+    uint64_t triangleOffset;
+    uint64_t nodeOffset;
+};
+
+class CollisionCache
+{
+public:
+    static const uint32_t VERSION = 2;
+
+    // Points mesh and bvh at the mapped cache if it exists and matches the source asset
+    bool Open(const std::string& cachePath, const std::string& sourcePath,
+        CollisionMesh& mesh, CollisionBVH& bvh)
+    {
+        if (!m_File.Open(cachePath))
+            return false;
+
+        if (m_File.GetSize() < sizeof(CollisionCacheHeader))
+        {
+            m_File.Close();
+            return false;
+        }
+
+        CollisionCacheHeader header;
+        memcpy(&header, m_File.GetData(), sizeof(header));
+
+        uint64_t triangleBytes = (uint64_t)header.triangleCount * CollisionMesh::STREAM_COUNT * sizeof(float);
+        uint64_t nodeBytes = (uint64_t)header.nodeCount * sizeof(BVHNode);
+
+        if (memcmp(header.magic, "HCCL", 4) != 0 ||
+            header.version != VERSION ||
+            !IsSourceCurrent(sourcePath, header.source) ||
+            header.streamCount != CollisionMesh::STREAM_COUNT ||
+            header.nodeSize != sizeof(BVHNode) ||
+            header.triangleOffset % alignof(float) != 0 ||
+            header.nodeOffset % alignof(BVHNode) != 0 ||
+            header.triangleOffset + triangleBytes > m_File.GetSize() ||
+            header.nodeOffset + nodeBytes > m_File.GetSize())
+        {
+            std::cout << "Collision cache " << cachePath << " is stale, rebuilding" << std::endl;
+            m_File.Close();
+            return false;
+        }
+
+        // the traversal trusts the nodes, so a damaged tree is rebuilt like a stale one
+        const unsigned char* data = m_File.GetData();
+        if (!CollisionBVH::Validate((const BVHNode*)(data + header.nodeOffset), header.nodeCount, header.triangleCount))
+        {
+            std::cout << "Collision cache " << cachePath << " is stale, rebuilding" << std::endl;
+            m_File.Close();
+            return false;
+        }
+
+        mesh.View((const float*)(data + header.triangleOffset), header.triangleCount);
+        bvh.View((const BVHNode*)(data + header.nodeOffset), header.nodeCount);
+        return true;
+    }
+
+    static bool Write(const std::string& cachePath, const std::string& sourcePath,
+        const CollisionMesh& mesh, const CollisionBVH& bvh)
+    {
+        CollisionCacheHeader header;
+        memcpy(header.magic, "HCCL", 4);
+        header.version = VERSION;
+        if (!StampFile(sourcePath, header.source))
+            return false;
+        header.triangleCount = (uint32_t)mesh.GetTriangleCount();
+        header.nodeCount = (uint32_t)bvh.GetNodeCount();
+        header.streamCount = CollisionMesh::STREAM_COUNT;
+        header.nodeSize = sizeof(BVHNode);
+        header.triangleOffset = sizeof(CollisionCacheHeader);
+        header.nodeOffset = AlignUp(header.triangleOffset + mesh.GetMemoryUsage(), 16);
+
+        std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "Failed to write collision cache " << cachePath << std::endl;
+            return false;
+        }
+
+        const char padding[16] = {};
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)mesh.GetData(), mesh.GetMemoryUsage());
+        out.write(padding, header.nodeOffset - header.triangleOffset - mesh.GetMemoryUsage());
+        out.write((const char*)bvh.GetNodes(), bvh.GetMemoryUsage());
+        return (bool)out;
+    }
+
+private:
+    static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    MappedFile m_File;
+};
+
+// Maps the collision cache of the map asset, baking and writing it first when it is
+// missing or stale. The cache must stay alive as long as mesh and bvh are used.
+inline void LoadMapCollision(const Model& mapModel, const std::string& sourcePath,
+    CollisionCache& cache, CollisionMesh& mesh, CollisionBVH& bvh)
+{
+    std::string cachePath = sourcePath + ".collision";
+    if (cache.Open(cachePath, sourcePath, mesh, bvh))
+        return;
+
+    mesh.Bake(mapModel);
+    bvh.Build(mesh);
+    CollisionCache::Write(cachePath, sourcePath, mesh, bvh);
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+/* Spatial hash over the XZ plane: an alternative broadphase to the BVH for wide, flat
+   levels. Every triangle is registered in each cell its AABB covers; cells hash into
+   a fixed bucket table stored as one flat array. Exposes the same QuerySphereLeaves
+   interface as CollisionBVH, reporting one triangle per call. */
+
+#include <vector>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <learnopengl/collision_mesh.h>
+#include <learnopengl/collision_bvh.h>
+
+class CollisionGrid
+{
+public:
+    struct Entry
+    {
+        int triangle;
+        int cellX;
+        int cellZ;
+    };
+
+    CollisionGrid() = default;
+
+    CollisionGrid(const CollisionMesh& mesh, float cellSize)
+    {
+        Build(mesh, cellSize);
+    }
+
+    void Build(const CollisionMesh& mesh, float cellSize)
+    {
+        m_Mesh = &mesh;
+        m_CellSize = cellSize;
+        m_InvCellSize = 1.0f / cellSize;
+
+        size_t count = mesh.GetTriangleCount();
+
+        // count (triangle, cell) pairs first so the bucket table can be sized once
+        size_t entryCount = 0;
+        for (size_t tri = 0; tri < count; tri++)
+        {
+            int x0, z0, x1, z1;
+            CellRange(mesh.GetBoundsMin(tri), mesh.GetBoundsMax(tri), x0, z0, x1, z1);
+            entryCount += (size_t)(x1 - x0 + 1) * (z1 - z0 + 1);
+        }
+
+        size_t bucketCount = 1;
+        while (bucketCount < entryCount)
+            bucketCount <<= 1;
+        m_BucketMask = bucketCount - 1;
+
+        m_BucketStart.assign(bucketCount + 1, 0);
+        for (size_t tri = 0; tri < count; tri++)
+        {
+            int x0, z0, x1, z1;
+            CellRange(mesh.GetBoundsMin(tri), mesh.GetBoundsMax(tri), x0, z0, x1, z1);
+            for (int x = x0; x <= x1; x++)
+                for (int z = z0; z <= z1; z++)
+                    m_BucketStart[Hash(x, z) + 1]++;
+        }
+        for (size_t b = 0; b < bucketCount; b++)
+            m_BucketStart[b + 1] += m_BucketStart[b];
+
+        m_Entries.resize(entryCount);
+        std::vector<unsigned int> fill(m_BucketStart.begin(), m_BucketStart.end() - 1);
+        for (size_t tri = 0; tri < count; tri++)
+        {
+            int x0, z0, x1, z1;
+            CellRange(mesh.GetBoundsMin(tri), mesh.GetBoundsMax(tri), x0, z0, x1, z1);
+            for (int x = x0; x <= x1; x++)
+            {
+                for (int z = z0; z <= z1; z++)
+                {
+                    Entry entry;
+                    entry.triangle = (int)tri;
+                    entry.cellX = x;
+                    entry.cellZ = z;
+                    m_Entries[fill[Hash(x, z)]++] = entry;
+                }
+            }
+        }
+    }
+
+    // Calls fn(triangle, 1) once for every triangle whose AABB overlaps the sphere's box.
+    // A triangle spanning several cells is only reported from the first cell the query
+    // and the triangle share, so no per-query bookkeeping is needed.
+    template <typename Fn>
+    bool QuerySphereLeaves(const glm::vec3& center, float radius, Fn&& fn) const
+    {
+        if (m_Entries.empty())
+            return false;
+
+        glm::vec3 boxMin = center - glm::vec3(radius);
+        glm::vec3 boxMax = center + glm::vec3(radius);
+
+        int x0, z0, x1, z1;
+        CellRange(boxMin, boxMax, x0, z0, x1, z1);
+
+        for (int x = x0; x <= x1; x++)
+        {
+            for (int z = z0; z <= z1; z++)
+            {
+                size_t bucket = Hash(x, z);
+                for (unsigned int e = m_BucketStart[bucket]; e < m_BucketStart[bucket + 1]; e++)
+                {
+                    const Entry& entry = m_Entries[e];
+                    if (entry.cellX != x || entry.cellZ != z)
+                        continue;
+
+                    glm::vec3 triMin = m_Mesh->GetBoundsMin(entry.triangle);
+                    glm::vec3 triMax = m_Mesh->GetBoundsMax(entry.triangle);
+                    if (!AABBOverlapsAABB(boxMin, boxMax, triMin, triMax))
+                        continue;
+
+                    int firstX = std::max(x0, CellCoord(triMin.x));
+                    int firstZ = std::max(z0, CellCoord(triMin.z));
+                    if (x != firstX || z != firstZ)
+                        continue;
+
+                    if (fn(entry.triangle, 1))
+                        return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    inline float GetCellSize() const { return m_CellSize; }
+    inline size_t GetEntryCount() const { return m_Entries.size(); }
+
+    size_t GetMemoryUsage() const
+    {
+        return m_Entries.size() * sizeof(Entry) + m_BucketStart.size() * sizeof(unsigned int);
+    }
+
+private:
+    inline int CellCoord(float v) const
+    {
+        return (int)std::floor(v * m_InvCellSize);
+    }
+
+    inline void CellRange(const glm::vec3& boxMin, const glm::vec3& boxMax, int& x0, int& z0, int& x1, int& z1) const
+    {
+        x0 = CellCoord(boxMin.x);
+        z0 = CellCoord(boxMin.z);
+        x1 = CellCoord(boxMax.x);
+        z1 = CellCoord(boxMax.z);
+    }
+
+    inline size_t Hash(int x, int z) const
+    {
+        return ((unsigned int)x * 73856093u ^ (unsigned int)z * 19349663u) & m_BucketMask;
+    }
+
+    std::vector<Entry> m_Entries;
+    std::vector<unsigned int> m_BucketStart;
+    size_t m_BucketMask = 0;
+    float m_CellSize = 1.0f;
+    float m_InvCellSize = 1.0f;
+    const CollisionMesh* m_Mesh = nullptr;
+};
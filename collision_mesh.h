@@ -0,0 +1,176 @@
+#pragma once
+
+/* World-space triangle soup baked from a Model for collision queries.
+   Triangles are de-indexed and stored as structure-of-arrays: a vertex, the two
+   edges ab/ac and a per-triangle AABB, so a query touches only what it needs.
+   All streams live in one contiguous block, which is either owned by the mesh or
+   viewed in place (e.g. a memory-mapped collision cache). */
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <learnopengl/model_animation.h>
+#include <learnopengl/collision_utils.h>
+
+struct CollisionMesh
+{
+    enum Stream
+    {
+        AX, AY, AZ,
+        ABX, ABY, ABZ,
+        ACX, ACY, ACZ,
+        MIN_X, MIN_Y, MIN_Z,
+        MAX_X, MAX_Y, MAX_Z,
+        STREAM_COUNT
+    };
+
+    CollisionMesh() = default;
+
+    CollisionMesh(const Model& model)
+    {
+        Bake(model);
+    }
+
+    CollisionMesh(const CollisionMesh&) = delete;
+    CollisionMesh& operator=(const CollisionMesh&) = delete;
+    CollisionMesh(CollisionMesh&&) = default;
+    CollisionMesh& operator=(CollisionMesh&&) = default;
+
+    void Bake(const Model& model)
+    {
+        size_t count = 0;
+        for (const auto& mesh : model.meshes)
+            count += mesh.indices.size() / 3;
+        Resize(count);
+
+        size_t t = 0;
+        for (const auto& mesh : model.meshes)
+        {
+            const auto& verts = mesh.vertices;
+            const auto& idx = mesh.indices;
+
+            for (size_t i = 0; i + 2 < idx.size(); i += 3, t++)
+            {
+                glm::vec3 a = verts[idx[i]].Position;
+                glm::vec3 b = verts[idx[i + 1]].Position;
+                glm::vec3 c = verts[idx[i + 2]].Position;
+                SetTriangle(t, a, b, c);
+            }
+        }
+    }
+
+    void Resize(size_t count)
+    {
+        m_Storage.assign(count * STREAM_COUNT, 0.0f);
+        BindStreams(m_Storage.data(), count);
+    }
+
+    // Uses count triangles laid out as STREAM_COUNT consecutive streams at data without
+    // copying; data must outlive the mesh
+    void View(const float* data, size_t count)
+    {
+        m_Storage.clear();
+        m_Storage.shrink_to_fit();
+        BindStreams(data, count);
+    }
+
+    void SetTriangle(size_t i, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        glm::vec3 ab = b - a;
+        glm::vec3 ac = c - a;
+        glm::vec3 lo = glm::min(a, glm::min(b, c));
+        glm::vec3 hi = glm::max(a, glm::max(b, c));
+
+        const float values[STREAM_COUNT] = {
+            a.x, a.y, a.z, ab.x, ab.y, ab.z, ac.x, ac.y, ac.z,
+            lo.x, lo.y, lo.z, hi.x, hi.y, hi.z
+        };
+        for (int s = 0; s < STREAM_COUNT; s++)
+            m_Storage[s * m_Count + i] = values[s];
+    }
+
+    // Permutes the triangles so that triangle i becomes order[i]
+    void Reorder(const std::vector<int>& order)
+    {
+        std::vector<float> sorted(m_Storage.size());
+        for (int s = 0; s < STREAM_COUNT; s++)
+        {
+            const float* src = &m_Storage[s * m_Count];
+            float* dst = &sorted[s * m_Count];
+            for (size_t i = 0; i < order.size(); i++)
+                dst[i] = src[order[i]];
+        }
+        m_Storage.swap(sorted);
+        BindStreams(m_Storage.data(), m_Count);
+    }
+
+    inline size_t GetTriangleCount() const { return m_Count; }
+    inline glm::vec3 GetA(size_t i) const { return glm::vec3(ax[i], ay[i], az[i]); }
+    inline glm::vec3 GetAB(size_t i) const { return glm::vec3(abx[i], aby[i], abz[i]); }
+    inline glm::vec3 GetAC(size_t i) const { return glm::vec3(acx[i], acy[i], acz[i]); }
+    inline glm::vec3 GetBoundsMin(size_t i) const { return glm::vec3(minX[i], minY[i], minZ[i]); }
+    inline glm::vec3 GetBoundsMax(size_t i) const { return glm::vec3(maxX[i], maxY[i], maxZ[i]); }
+
+    inline bool TestSphere(size_t i, const glm::vec3& center, float radius, glm::vec3& outP) const
+    {
+        // cheap reject on the triangle's own box before the closest-point test
+        if (center.x + radius < minX[i] || center.x - radius > maxX[i] ||
+            center.y + radius < minY[i] || center.y - radius > maxY[i] ||
+            center.z + radius < minZ[i] || center.z - radius > maxZ[i])
+            return false;
+
+        return TestSphereTriangleEdges(center, radius, GetA(i), GetAB(i), GetAC(i), outP);
+    }
+
+    inline bool Raycast(size_t i, const glm::vec3& rayOrig, const glm::vec3& rayDir,
+        float& t, float& u, float& v) const
+    {
+        return MollerTrumboreEdges(rayOrig, rayDir, GetA(i), GetAB(i), GetAC(i), t, u, v);
+    }
+
+    inline const float* GetData() const { return ax; }
+
+    size_t GetMemoryUsage() const
+    {
+        return m_Count * STREAM_COUNT * sizeof(float);
+    }
+
+    // Memory the same triangles take in the indexed Vertex layout used for rendering
+    static size_t GetIndexedMemoryUsage(const Model& model)
+    {
+        size_t bytes = 0;
+        for (const auto& mesh : model.meshes)
+            bytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+        return bytes;
+    }
+
+    const float* ax = nullptr;
+    const float* ay = nullptr;
+    const float* az = nullptr;
+    const float* abx = nullptr;
+    const float* aby = nullptr;
+    const float* abz = nullptr;
+    const float* acx = nullptr;
+    const float* acy = nullptr;
+    const float* acz = nullptr;
+    const float* minX = nullptr;
+    const float* minY = nullptr;
+    const float* minZ = nullptr;
+    const float* maxX = nullptr;
+    const float* maxY = nullptr;
+    const float* maxZ = nullptr;
+
+private:
+    void BindStreams(const float* base, size_t count)
+    {
+        const float** streams[STREAM_COUNT] = {
+            &ax, &ay, &az, &abx, &aby, &abz, &acx, &acy, &acz,
+            &minX, &minY, &minZ, &maxX, &maxY, &maxZ
+        };
+        for (int s = 0; s < STREAM_COUNT; s++)
+            *streams[s] = base + s * count;
+        m_Count = count;
+    }
+
+    std::vector<float> m_Storage;
+    size_t m_Count = 0;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+/* Ray queries against the map: downward rays through the BVH give the floor height
+   under a point, a cheaper alternative to the sphere overlap floor resolution.
+   Swept spheres give the time of impact of a moving sphere, so a large step can not
+   tunnel through thin geometry. */
+
+#include <glm/glm.hpp>
+#include <learnopengl/collision_mesh.h>
+#include <learnopengl/collision_bvh.h>
+
+struct FloorHit
+{
+    float height;
+    glm::vec3 normal;
+    int triangle;
+};
+
+// Nearest triangle hit by the ray segment [0, maxT] whose upward facing normal has a
+// y component of at least minNormalY. Triangles are treated as two-sided.
+inline bool RaycastMap(const CollisionMesh& mesh, const CollisionBVH& bvh,
+    const glm::vec3& orig, const glm::vec3& dir, float maxT, float minNormalY,
+    float& outT, glm::vec3& outNormal, int& outTriangle)
+{
+    float bestT = maxT;
+    bool found = false;
+
+    bvh.QueryRayLeaves(orig, dir, bestT, [&](int first, int count)
+        {
+            for (int tri = first; tri < first + count; tri++)
+            {
+                float t, u, v;
+                if (!mesh.Raycast(tri, orig, dir, t, u, v) || t > bestT)
+                    continue;
+
+                glm::vec3 normal = glm::normalize(glm::cross(mesh.GetAB(tri), mesh.GetAC(tri)));
+                if (glm::dot(normal, dir) > 0.0f)
+                    normal = -normal;
+                if (normal.y < minNormalY)
+                    continue;
+
+                bestT = t;
+                outNormal = normal;
+                outTriangle = tri;
+                found = true;
+            }
+            return false;
+        });
+
+    outT = bestT;
+    return found;
+}
+
+// Height of the walkable floor at most maxDrop below pos. Surfaces steeper than
+// acos(minNormalY) are ignored.
+inline bool QueryFloorHeight(const CollisionMesh& mesh, const CollisionBVH& bvh,
+    const glm::vec3& pos, float maxDrop, FloorHit& outHit, float minNormalY = 0.5f)
+{
+    float t;
+    if (!RaycastMap(mesh, bvh, pos, glm::vec3(0.0f, -1.0f, 0.0f), maxDrop, minNormalY,
+        t, outHit.normal, outHit.triangle))
+        return false;
+
+    outHit.height = pos.y - t;
+    return true;
+}
+
+// Batched version for NPCs and particle ground snapping. outFound[i] tells whether
+// outHits[i] is valid; returns the number of rays that found a floor.
+inline int QueryFloorHeights(const CollisionMesh& mesh, const CollisionBVH& bvh,
+    const glm::vec3* positions, size_t count, float maxDrop,
+    FloorHit* outHits, bool* outFound, float minNormalY = 0.5f)
+{
+    int found = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        outFound[i] = QueryFloorHeight(mesh, bvh, positions[i], maxDrop, outHits[i], minNormalY);
+        if (outFound[i])
+            found++;
+    }
+    return found;
+}
+
+struct SweepHit
+{
+    float toi;          // fraction of the move travelled before contact
+    glm::vec3 contact;
+    glm::vec3 normal;   // from the contact towards the sphere centre at impact
+    int triangle;
+};
+
+// Earliest contact of the sphere moving from center to center + move with the map
+inline bool SweepSphereMap(const CollisionMesh& mesh, const CollisionBVH& bvh,
+    const glm::vec3& center, float radius, const glm::vec3& move, SweepHit& outHit)
+{
+    glm::vec3 boxMin = glm::min(center, center + move) - glm::vec3(radius);
+    glm::vec3 boxMax = glm::max(center, center + move) + glm::vec3(radius);
+
+    bool found = false;
+    outHit.toi = 1.0f;
+
+    bvh.QueryAABBLeaves(boxMin, boxMax, [&](int first, int count)
+        {
+            for (int tri = first; tri < first + count; tri++)
+            {
+                float toi;
+                glm::vec3 contact;
+                if (!SweptSphereTriangle(center, radius, move, mesh.GetA(tri), mesh.GetAB(tri), mesh.GetAC(tri), toi, contact))
+                    continue;
+
+                if (!found || toi < outHit.toi)
+                {
+                    outHit.toi = toi;
+                    outHit.contact = contact;
+                    outHit.triangle = tri;
+                    found = true;
+                }
+            }
+            return false;
+        });
+
+    if (found)
+    {
+        glm::vec3 offset = center + move * outHit.toi - outHit.contact;
+        float len = glm::length(offset);
+        outHit.normal = len > 1e-6f ? offset / len : -glm::normalize(move);
+    }
+    return found;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+/* Packet versions of the sphere-triangle test: one sphere against 4 (SSE) or
+   8 (AVX2) triangles of a CollisionMesh at once. The branches of
+   ClosestPtPointTriangleEdges become lane selects evaluated in reverse priority
+   order, with the same arithmetic in the same order, so every lane gives the hit
+   and closest point of the scalar test. Against ClosestPtPointTriangle on the
+   vertices this is exact whenever the stored edges are exactly b - a and c - a,
+   and the build does not fuse multiply-adds; when it does (GCC and Clang with FMA
+   enabled), each path may fuse different ones and points can differ by a few ulps.
+   --self-test checks both cases.
+   The widest available kernel is chosen at build time; without SSE the batch
+   entry point falls back to the scalar test. */
+
+#include <cassert>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <learnopengl/collision_mesh.h>
+#include <learnopengl/collision_utils.h>
+#include <learnopengl/simd.h>
+
+#define COLLISION_SIMD_WIDTH SIMD_WIDTH
+
+// Tests triangles [first, first + S::WIDTH) of the mesh. Returns a bit mask of the
+// triangles the sphere touches and writes every lane's closest point to outP.
+template <typename S>
+inline unsigned int TestSphereTrianglePacket(const glm::vec3& center, float radius,
+    const CollisionMesh& mesh, size_t first, glm::vec3* outP)
+{
+    typedef typename S::Reg Reg;
+
+    const Reg zero = S::Set1(0.0f);
+    const Reg px = S::Set1(center.x), py = S::Set1(center.y), pz = S::Set1(center.z);
+
+    Reg ax = S::Load(&mesh.ax[first]), ay = S::Load(&mesh.ay[first]), az = S::Load(&mesh.az[first]);
+    Reg abx = S::Load(&mesh.abx[first]), aby = S::Load(&mesh.aby[first]), abz = S::Load(&mesh.abz[first]);
+    Reg acx = S::Load(&mesh.acx[first]), acy = S::Load(&mesh.acy[first]), acz = S::Load(&mesh.acz[first]);
+
+    Reg apx = S::Sub(px, ax), apy = S::Sub(py, ay), apz = S::Sub(pz, az);
+    Reg d1 = S::Add(S::Add(S::Mul(abx, apx), S::Mul(aby, apy)), S::Mul(abz, apz));
+    Reg d2 = S::Add(S::Add(S::Mul(acx, apx), S::Mul(acy, apy)), S::Mul(acz, apz));
+
+    Reg bpx = S::Sub(apx, abx), bpy = S::Sub(apy, aby), bpz = S::Sub(apz, abz);
+    Reg d3 = S::Add(S::Add(S::Mul(abx, bpx), S::Mul(aby, bpy)), S::Mul(abz, bpz));
+    Reg d4 = S::Add(S::Add(S::Mul(acx, bpx), S::Mul(acy, bpy)), S::Mul(acz, bpz));
+
+    Reg cpx = S::Sub(apx, acx), cpy = S::Sub(apy, acy), cpz = S::Sub(apz, acz);
+    Reg d5 = S::Add(S::Add(S::Mul(abx, cpx), S::Mul(aby, cpy)), S::Mul(abz, cpz));
+    Reg d6 = S::Add(S::Add(S::Mul(acx, cpx), S::Mul(acy, cpy)), S::Mul(acz, cpz));
+
+    Reg vc = S::Sub(S::Mul(d1, d4), S::Mul(d3, d2));
+    Reg vb = S::Sub(S::Mul(d5, d2), S::Mul(d1, d6));
+    Reg va = S::Sub(S::Mul(d3, d6), S::Mul(d5, d4));
+
+    // interior
+    Reg denom = S::Div(S::Set1(1.0f), S::Add(S::Add(va, vb), vc));
+    Reg v = S::Mul(vb, denom);
+    Reg w = S::Mul(vc, denom);
+    Reg rx = S::Add(S::Add(ax, S::Mul(abx, v)), S::Mul(acx, w));
+    Reg ry = S::Add(S::Add(ay, S::Mul(aby, v)), S::Mul(acy, w));
+    Reg rz = S::Add(S::Add(az, S::Mul(abz, v)), S::Mul(acz, w));
+
+    Reg bx = S::Add(ax, abx), by = S::Add(ay, aby), bz = S::Add(az, abz);
+    Reg cx = S::Add(ax, acx), cy = S::Add(ay, acy), cz = S::Add(az, acz);
+
+    // edge bc
+    Reg d43 = S::Sub(d4, d3);
+    Reg d56 = S::Sub(d5, d6);
+    Reg m = S::And(S::Le(va, zero), S::And(S::Ge(d43, zero), S::Ge(d56, zero)));
+    Reg t = S::Div(d43, S::Add(d43, d56));
+    rx = S::Select(m, S::Add(bx, S::Mul(S::Sub(acx, abx), t)), rx);
+    ry = S::Select(m, S::Add(by, S::Mul(S::Sub(acy, aby), t)), ry);
+    rz = S::Select(m, S::Add(bz, S::Mul(S::Sub(acz, abz), t)), rz);
+
+    // edge ac
+    m = S::And(S::Le(vb, zero), S::And(S::Ge(d2, zero), S::Le(d6, zero)));
+    t = S::Div(d2, S::Sub(d2, d6));
+    rx = S::Select(m, S::Add(ax, S::Mul(acx, t)), rx);
+    ry = S::Select(m, S::Add(ay, S::Mul(acy, t)), ry);
+    rz = S::Select(m, S::Add(az, S::Mul(acz, t)), rz);
+
+    // vertex c
+    m = S::And(S::Ge(d6, zero), S::Le(d5, d6));
+    rx = S::Select(m, cx, rx);
+    ry = S::Select(m, cy, ry);
+    rz = S::Select(m, cz, rz);
+
+    // edge ab
+    m = S::And(S::Le(vc, zero), S::And(S::Ge(d1, zero), S::Le(d3, zero)));
+    t = S::Div(d1, S::Sub(d1, d3));
+    rx = S::Select(m, S::Add(ax, S::Mul(abx, t)), rx);
+    ry = S::Select(m, S::Add(ay, S::Mul(aby, t)), ry);
+    rz = S::Select(m, S::Add(az, S::Mul(abz, t)), rz);
+
+    // vertex b
+    m = S::And(S::Ge(d3, zero), S::Le(d4, d3));
+    rx = S::Select(m, bx, rx);
+    ry = S::Select(m, by, ry);
+    rz = S::Select(m, bz, rz);
+
+    // vertex a
+    m = S::And(S::Le(d1, zero), S::Le(d2, zero));
+    rx = S::Select(m, ax, rx);
+    ry = S::Select(m, ay, ry);
+    rz = S::Select(m, az, rz);
+
+    Reg dx = S::Sub(px, rx), dy = S::Sub(py, ry), dz = S::Sub(pz, rz);
+    Reg dist2 = S::Add(S::Add(S::Mul(dx, dx), S::Mul(dy, dy)), S::Mul(dz, dz));
+    Reg hit = S::Le(dist2, S::Set1(radius * radius));
+
+    float x[S::WIDTH], y[S::WIDTH], z[S::WIDTH];
+    S::Store(x, rx);
+    S::Store(y, ry);
+    S::Store(z, rz);
+    for (int i = 0; i < S::WIDTH; i++)
+        outP[i] = glm::vec3(x[i], y[i], z[i]);
+
+    return (unsigned int)S::MoveMask(hit);
+}
+
+// Tests triangles [first, first + count) with the widest kernel available and the
+// scalar test for the remainder. outP receives one closest point per triangle, so
+// count may not exceed its size; the hit mask limits that to 32.
+template <size_t N>
+inline unsigned int TestSphereTriangles(const glm::vec3& center, float radius,
+    const CollisionMesh& mesh, size_t first, int count, glm::vec3 (&outP)[N])
+{
+    static_assert(N <= 32, "the hit mask has one bit per triangle");
+    assert(count >= 0 && count <= (int)N);
+
+    unsigned int mask = 0;
+    int i = 0;
+
+#if COLLISION_SIMD_WIDTH >= 8
+    for (; i + 8 <= count; i += 8)
+        mask |= TestSphereTrianglePacket<SimdAVX>(center, radius, mesh, first + i, outP + i) << i;
+#endif
+#if COLLISION_SIMD_WIDTH >= 4
+    for (; i + 4 <= count; i += 4)
+        mask |= TestSphereTrianglePacket<SimdSSE>(center, radius, mesh, first + i, outP + i) << i;
+#endif
+    for (; i < count; i++)
+    {
+        size_t tri = first + i;
+        if (TestSphereTriangleEdges(center, radius, mesh.GetA(tri), mesh.GetAB(tri), mesh.GetAC(tri), outP[i]))
+            mask |= 1u << i;
+    }
+
+    return mask;
+}
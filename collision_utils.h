@@ -2,6 +2,7 @@
 #include <glm/gtx/norm.hpp>
 #include <glm/glm.hpp>
 #include <cmath>
+#include <utility>
 
 glm::vec3 ClosestPtPointTriangle(const glm::vec3& p,
     const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
@@ -73,3 +74,200 @@ bool MollerTrumbore(const glm::vec3& rayOrig, const glm::vec3& rayDir,
     t = glm::dot(e2, q) * inv;
     return t > EPS;
 }
+
+// Same tests on triangles stored as a vertex plus two edges (see CollisionMesh)
+inline glm::vec3 ClosestPtPointTriangleEdges(const glm::vec3& p,
+    const glm::vec3& a, const glm::vec3& ab, const glm::vec3& ac)
+{
+    glm::vec3 ap = p - a;
+
+    float d1 = glm::dot(ab, ap);
+    float d2 = glm::dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0) return a;
+
+    glm::vec3 bp = ap - ab;
+    float d3 = glm::dot(ab, bp);
+    float d4 = glm::dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3) return a + ab;
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        return a + ab * (d1 / (d1 - d3));
+
+    glm::vec3 cp = ap - ac;
+    float d5 = glm::dot(ab, cp);
+    float d6 = glm::dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6) return a + ac;
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        return a + ac * (d2 / (d2 - d6));
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        return a + ab + (ac - ab) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    float denom = 1.0f / (va + vb + vc);
+    float v = vb * denom;
+    float w = vc * denom;
+    return a + ab * v + ac * w;
+}
+
+inline bool TestSphereTriangleEdges(const glm::vec3& center, float radius,
+    const glm::vec3& a, const glm::vec3& ab, const glm::vec3& ac,
+    glm::vec3& outP)
+{
+    outP = ClosestPtPointTriangleEdges(center, a, ab, ac);
+    return glm::length2(center - outP) <= radius * radius;
+}
+
+inline bool MollerTrumboreEdges(const glm::vec3& rayOrig, const glm::vec3& rayDir,
+    const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2,
+    float& t, float& u, float& v)
+{
+    const float EPS = 1e-6;
+    glm::vec3 p = glm::cross(rayDir, e2);
+    float det = glm::dot(e1, p);
+    if (fabs(det) < EPS) return false;
+
+    float inv = 1.0f / det;
+    glm::vec3 tvec = rayOrig - v0;
+    u = glm::dot(tvec, p) * inv;
+    if (u < 0 || u > 1) return false;
+
+    glm::vec3 q = glm::cross(tvec, e1);
+    v = glm::dot(rayDir, q) * inv;
+    if (v < 0 || u + v > 1) return false;
+
+    t = glm::dot(e2, q) * inv;
+    return t > EPS;
+}
+
+// Smallest root of a*t^2 + b*t + c = 0 in [0, maxT]
+inline bool LowestRoot(float a, float b, float c, float maxT, float& root)
+{
+    if (fabs(a) < 1e-12f)
+    {
+        if (fabs(b) < 1e-12f) return false;
+        float t = -c / b;
+        if (t < 0 || t > maxT) return false;
+        root = t;
+        return true;
+    }
+
+    float disc = b * b - 4.0f * a * c;
+    if (disc < 0) return false;
+
+    float sq = sqrtf(disc);
+    float r1 = (-b - sq) / (2.0f * a);
+    float r2 = (-b + sq) / (2.0f * a);
+    if (r1 > r2) std::swap(r1, r2);
+
+    if (r1 >= 0 && r1 <= maxT) { root = r1; return true; }
+    if (r2 >= 0 && r2 <= maxT) { root = r2; return true; }
+    return false;
+}
+
+// Sphere moving from center to center + move against triangle (a, a + ab, a + ac).
+// Returns the earliest time of impact toi in [0, 1] as a fraction of move, and the
+// contact point on the triangle. A sphere that already touches the triangle hits at 0
+// if it moves towards the contact, and ignores the triangle if it slides along or away.
+inline bool SweptSphereTriangle(const glm::vec3& center, float radius, const glm::vec3& move,
+    const glm::vec3& a, const glm::vec3& ab, const glm::vec3& ac,
+    float& toi, glm::vec3& outContact)
+{
+    if (TestSphereTriangleEdges(center, radius, a, ab, ac, outContact))
+    {
+        toi = 0.0f;
+        return glm::dot(move, outContact - center) > 0;
+    }
+
+    glm::vec3 n = glm::cross(ab, ac);
+    float nLen = glm::length(n);
+    if (nLen < 1e-12f) return false;
+    n /= nLen;
+
+    // triangles are two-sided: face the plane normal towards the sphere
+    float dist = glm::dot(center - a, n);
+    if (dist < 0)
+    {
+        n = -n;
+        dist = -dist;
+    }
+
+    // clear of the plane and not approaching it: the triangle is out of reach. A sphere
+    // that already cuts the plane lies beside the triangle, or the overlap test above
+    // would have caught it, so whichever way it moves it can only reach it across an edge.
+    float nDotMove = glm::dot(n, move);
+    if (dist >= radius && nDotMove >= 0) return false;
+
+    // face: first touch of the plane, valid if the touching point is inside the triangle
+    if (dist >= radius)
+    {
+        float tPlane = (dist - radius) / -nDotMove;
+        if (tPlane > 1.0f) return false;
+
+        glm::vec3 planePoint = center + move * tPlane - n * radius;
+        glm::vec3 ap = planePoint - a;
+        float d00 = glm::dot(ab, ab), d01 = glm::dot(ab, ac), d11 = glm::dot(ac, ac);
+        float d20 = glm::dot(ap, ab), d21 = glm::dot(ap, ac);
+        float denom = d00 * d11 - d01 * d01;
+        float v = (d11 * d20 - d01 * d21) / denom;
+        float w = (d00 * d21 - d01 * d20) / denom;
+        if (v >= 0 && w >= 0 && v + w <= 1)
+        {
+            toi = tPlane;
+            outContact = planePoint;
+            return true;
+        }
+    }
+
+    // otherwise the sphere can only hit a vertex or an edge
+    bool found = false;
+    float best = 1.0f;
+    float moveSq = glm::dot(move, move);
+    glm::vec3 verts[3] = { a, a + ab, a + ac };
+
+    for (int i = 0; i < 3; i++)
+    {
+        glm::vec3 toCenter = center - verts[i];
+        float t;
+        if (LowestRoot(moveSq, 2.0f * glm::dot(move, toCenter),
+            glm::dot(toCenter, toCenter) - radius * radius, best, t))
+        {
+            best = t;
+            outContact = verts[i];
+            found = true;
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        glm::vec3 p0 = verts[i];
+        glm::vec3 edge = verts[(i + 1) % 3] - p0;
+        glm::vec3 baseToVertex = p0 - center;
+
+        float edgeSq = glm::dot(edge, edge);
+        float edgeDotMove = glm::dot(edge, move);
+        float edgeDotBase = glm::dot(edge, baseToVertex);
+
+        float qa = edgeSq * -moveSq + edgeDotMove * edgeDotMove;
+        float qb = edgeSq * 2.0f * glm::dot(move, baseToVertex) - 2.0f * edgeDotMove * edgeDotBase;
+        float qc = edgeSq * (radius * radius - glm::dot(baseToVertex, baseToVertex)) + edgeDotBase * edgeDotBase;
+
+        float t;
+        if (LowestRoot(qa, qb, qc, best, t))
+        {
+            float f = (edgeDotMove * t - edgeDotBase) / edgeSq;
+            if (f >= 0 && f <= 1)
+            {
+                best = t;
+                outContact = p0 + edge * f;
+                found = true;
+            }
+        }
+    }
+
+    if (found) toi = best;
+    return found;
+}
@@ -0,0 +1,408 @@
+#pragma once
+
+/* Lossy compressed copy of an Animation's channels. Keys that interpolation between
+   the surrounding kept keys reproduces within a tolerance are dropped, and the rest
+   are quantised to 8 bytes each: translations and scales to 16 bits per component
+   inside the channel's range, rotations to the smallest-three encoding in 48 bits,
+   and key times to 16-bit tick steps. 16-bit ranges limit the achievable position
+   error to about extent / 131070 regardless of the tolerance. Likewise key times
+   off the tick grid move by up to half a time step, which adds up to the curve's
+   speed times that shift to the error. */
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <learnopengl/bone.h>
+#include <learnopengl/mapped_file.h>
+
+struct PackedKey
+{
+	uint16_t value[3];
+	uint16_t timeStamp;	// in steps of the clip's time quantum
+};
+
+struct CompressedChannel
+{
+	std::vector<PackedKey> positions;
+	std::vector<PackedKey> rotations;
+	std::vector<PackedKey> scales;
+	glm::vec3 positionMin, positionExtent;
+	glm::vec3 scaleMin, scaleExtent;
+};
+
+class CompressedClip
+{
+public:
+	// Tolerances are in bone space: model units for translation and scale, radians
+	// for rotation. They bound the error at every source key, and so everywhere,
+	// since both curves interpolate between keys; for keys off the tick grid, plus
+	// the time shift error (see GetTimeStep).
+	void Build(const std::vector<Bone>& bones, float duration, float positionTolerance = 0.001f,
+		float rotationTolerance = 0.001f, float scaleTolerance = 0.001f)
+	{
+		float lastTime = duration;
+		for (const Bone& bone : bones)
+		{
+			if (!bone.m_Positions.empty()) lastTime = std::max(lastTime, bone.m_Positions.back().timeStamp);
+			if (!bone.m_Rotations.empty()) lastTime = std::max(lastTime, bone.m_Rotations.back().timeStamp);
+			if (!bone.m_Scales.empty()) lastTime = std::max(lastTime, bone.m_Scales.back().timeStamp);
+		}
+		m_TimeScale = ChooseTimeScale(bones, lastTime);
+
+		auto mixVec3 = [](const glm::vec3& a, const glm::vec3& b, float alpha) { return glm::mix(a, b, alpha); };
+		auto mixQuat = [](const glm::quat& a, const glm::quat& b, float alpha) { return glm::normalize(glm::slerp(a, b, alpha)); };
+		auto vec3Error = [](const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b); };
+
+		m_Channels.assign(bones.size(), CompressedChannel());
+		for (size_t c = 0; c < bones.size(); c++)
+		{
+			const Bone& bone = bones[c];
+			CompressedChannel& channel = m_Channels[c];
+
+			ComputeRange(bone.m_Positions, [](const KeyPosition& key) { return key.position; },
+				channel.positionMin, channel.positionExtent);
+			ReduceKeys(bone.m_Positions, positionTolerance,
+				[](const KeyPosition& key) { return key.position; },
+				[&](const glm::vec3& v) { return EncodeVec3(v, channel.positionMin, channel.positionExtent); },
+				[&](const PackedKey& key) { return DecodeVec3(key, channel.positionMin, channel.positionExtent); },
+				mixVec3, vec3Error, channel.positions);
+
+			ReduceKeys(bone.m_Rotations, rotationTolerance,
+				[](const KeyRotation& key) { return glm::normalize(key.orientation); },
+				EncodeQuat, DecodeQuat, mixQuat, RotationError, channel.rotations);
+
+			ComputeRange(bone.m_Scales, [](const KeyScale& key) { return key.scale; },
+				channel.scaleMin, channel.scaleExtent);
+			ReduceKeys(bone.m_Scales, scaleTolerance,
+				[](const KeyScale& key) { return key.scale; },
+				[&](const glm::vec3& v) { return EncodeVec3(v, channel.scaleMin, channel.scaleExtent); },
+				[&](const PackedKey& key) { return DecodeVec3(key, channel.scaleMin, channel.scaleExtent); },
+				mixVec3, vec3Error, channel.scales);
+		}
+	}
+
+	// Same contract as Bone::Sample; the cursor indexes this clip's reduced keys
+	void Sample(int channelIndex, float animationTime, BoneCursor& cursor,
+		glm::vec3& position, glm::quat& rotation, glm::vec3& scale) const
+	{
+		const CompressedChannel& channel = m_Channels[channelIndex];
+		float time = animationTime * m_TimeScale;
+
+		int index;
+		float alpha;
+		Locate(channel.positions, time, cursor.position, index, alpha);
+		position = DecodeVec3(channel.positions[index], channel.positionMin, channel.positionExtent);
+		if (alpha > 0.0f)
+			position = glm::mix(position, DecodeVec3(channel.positions[index + 1], channel.positionMin, channel.positionExtent), alpha);
+
+		Locate(channel.rotations, time, cursor.rotation, index, alpha);
+		rotation = DecodeQuat(channel.rotations[index]);
+		if (alpha > 0.0f)
+			rotation = glm::normalize(glm::slerp(rotation, DecodeQuat(channel.rotations[index + 1]), alpha));
+
+		Locate(channel.scales, time, cursor.scale, index, alpha);
+		scale = DecodeVec3(channel.scales[index], channel.scaleMin, channel.scaleExtent);
+		if (alpha > 0.0f)
+			scale = glm::mix(scale, DecodeVec3(channel.scales[index + 1], channel.scaleMin, channel.scaleExtent), alpha);
+	}
+
+	// Largest difference from the source bones, sampled at every source key and
+	// halfway between keys
+	void MeasureError(const std::vector<Bone>& bones, float& maxPositionError,
+		float& maxRotationError, float& maxScaleError) const
+	{
+		maxPositionError = maxRotationError = maxScaleError = 0.0f;
+		std::vector<float> times;
+
+		for (size_t c = 0; c < bones.size() && c < m_Channels.size(); c++)
+		{
+			const Bone& bone = bones[c];
+			times.clear();
+			AddSampleTimes(bone.m_Positions, times);
+			AddSampleTimes(bone.m_Rotations, times);
+			AddSampleTimes(bone.m_Scales, times);
+
+			BoneCursor sourceCursor, cursor;
+			for (float t : times)
+			{
+				glm::vec3 sourceT, sourceS, T, S;
+				glm::quat sourceR, R;
+				bone.Sample(t, sourceCursor, sourceT, sourceR, sourceS);
+				Sample((int)c, t, cursor, T, R, S);
+
+				maxPositionError = std::max(maxPositionError, glm::length(sourceT - T));
+				maxRotationError = std::max(maxRotationError, RotationError(sourceR, R));
+				maxScaleError = std::max(maxScaleError, glm::length(sourceS - S));
+			}
+		}
+	}
+
+	inline bool IsBuilt() const { return !m_Channels.empty(); }
+
+	// Ticks per stored time step; keys off this grid are moved by up to half of it
+	inline float GetTimeStep() const { return m_TimeScale > 0.0f ? 1.0f / m_TimeScale : 0.0f; }
+
+	size_t GetKeyCount() const
+	{
+		size_t keys = 0;
+		for (const CompressedChannel& channel : m_Channels)
+			keys += channel.positions.size() + channel.rotations.size() + channel.scales.size();
+		return keys;
+	}
+
+	// Packed keys plus the per-channel ranges
+	size_t GetMemoryUsage() const
+	{
+		return GetKeyCount() * sizeof(PackedKey) + m_Channels.size() * 4 * sizeof(glm::vec3);
+	}
+
+	// Identifies the compressed data, so tables baked from it can tell when it changed
+	uint64_t GetContentHash() const
+	{
+		auto hashKeys = [](const std::vector<PackedKey>& keys, uint64_t hash)
+			{
+				return HashBytes((const unsigned char*)keys.data(), keys.size() * sizeof(PackedKey), hash);
+			};
+		auto hashVec3 = [](const glm::vec3& v, uint64_t hash)
+			{
+				float values[3] = { v.x, v.y, v.z };
+				return HashBytes((const unsigned char*)values, sizeof(values), hash);
+			};
+
+		uint64_t hash = HashBytes((const unsigned char*)&m_TimeScale, sizeof(m_TimeScale));
+		for (const CompressedChannel& channel : m_Channels)
+		{
+			hash = hashKeys(channel.positions, hash);
+			hash = hashKeys(channel.rotations, hash);
+			hash = hashKeys(channel.scales, hash);
+			hash = hashVec3(channel.positionMin, hash);
+			hash = hashVec3(channel.positionExtent, hash);
+			hash = hashVec3(channel.scaleMin, hash);
+			hash = hashVec3(channel.scaleExtent, hash);
+		}
+		return hash;
+	}
+
+	static size_t GetSourceKeyCount(const std::vector<Bone>& bones)
+	{
+		size_t keys = 0;
+		for (const Bone& bone : bones)
+			keys += bone.m_Positions.size() + bone.m_Rotations.size() + bone.m_Scales.size();
+		return keys;
+	}
+
+	// Angle in radians of the rotation between two unit quaternions; uses the chord
+	// length, which stays accurate for the tiny angles compression produces
+	static float RotationError(const glm::quat& a, const glm::quat& b)
+	{
+		glm::quat d = glm::dot(a, b) < 0.0f ? a + b : a - b;
+		float chord = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w);
+		return 4.0f * std::asin(std::min(chord * 0.5f, 1.0f));
+	}
+
+private:
+	template <typename Key, typename Value, typename Encode, typename Decode, typename Mix, typename Error>
+	void ReduceKeys(const std::vector<Key>& keys, float tolerance, Value value, Encode encode,
+		Decode decode, Mix mix, Error error, std::vector<PackedKey>& out) const
+	{
+		out.clear();
+		if (keys.empty())
+			return;
+
+		std::vector<PackedKey> packed(keys.size());
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			packed[i] = encode(value(keys[i]));
+			packed[i].timeStamp = QuantizeTime(keys[i].timeStamp);
+		}
+
+		// Keys between anchor and end are reproduced by interpolating the quantised
+		// end points; the check is against the source values, so quantisation error
+		// is included in the bound
+		auto spanFits = [&](size_t anchor, size_t end)
+			{
+				auto a = decode(packed[anchor]);
+				auto b = decode(packed[end]);
+				float span = (float)packed[end].timeStamp - packed[anchor].timeStamp;
+				for (size_t k = anchor + 1; k < end; k++)
+				{
+					float alpha = span > 0.0f
+						? glm::clamp((keys[k].timeStamp * m_TimeScale - packed[anchor].timeStamp) / span, 0.0f, 1.0f)
+						: 0.0f;
+					if (error(mix(a, b, alpha), value(keys[k])) > tolerance)
+						return false;
+				}
+				return true;
+			};
+
+		size_t anchor = 0;
+		out.push_back(packed[0]);
+		for (size_t end = 2; end < keys.size(); end++)
+		{
+			if (!spanFits(anchor, end))
+			{
+				out.push_back(packed[end - 1]);
+				anchor = end - 1;
+			}
+		}
+
+		if (keys.size() == 1)
+			return;
+
+		// a channel that holds still collapses to its first key
+		if (out.size() == 1)
+		{
+			bool constant = true;
+			auto first = decode(packed[0]);
+			for (size_t k = 0; k < keys.size() && constant; k++)
+				constant = error(first, value(keys[k])) <= tolerance;
+			if (constant)
+				return;
+		}
+		out.push_back(packed.back());
+	}
+
+	// Keys usually sit on whole (or halved, ...) ticks; if they do, use that step so
+	// key times are stored exactly, otherwise spread the 16 bits over the clip
+	static float ChooseTimeScale(const std::vector<Bone>& bones, float lastTime)
+	{
+		if (lastTime <= 0.0f)
+			return 0.0f;
+
+		float finest = 65535.0f / lastTime;
+		for (float scale = 1.0f; scale <= finest; scale *= 2.0f)
+		{
+			bool exact = true;
+			for (size_t b = 0; b < bones.size() && exact; b++)
+				exact = OnGrid(bones[b].m_Positions, scale) && OnGrid(bones[b].m_Rotations, scale)
+					&& OnGrid(bones[b].m_Scales, scale);
+			if (exact)
+				return scale;
+		}
+		return finest;
+	}
+
+	template <typename Key>
+	static bool OnGrid(const std::vector<Key>& keys, float scale)
+	{
+		for (const Key& key : keys)
+		{
+			float steps = key.timeStamp * scale;
+			if (std::fabs(steps - std::round(steps)) > 1e-3f)
+				return false;
+		}
+		return true;
+	}
+
+	template <typename Key, typename Value>
+	static void ComputeRange(const std::vector<Key>& keys, Value value, glm::vec3& outMin, glm::vec3& outExtent)
+	{
+		glm::vec3 lo(0.0f), hi(0.0f);
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			lo = i == 0 ? value(keys[i]) : glm::min(lo, value(keys[i]));
+			hi = i == 0 ? value(keys[i]) : glm::max(hi, value(keys[i]));
+		}
+		outMin = lo;
+		outExtent = hi - lo;
+	}
+
+	template <typename Key>
+	static void AddSampleTimes(const std::vector<Key>& keys, std::vector<float>& times)
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			times.push_back(keys[i].timeStamp);
+			if (i + 1 < keys.size())
+				times.push_back((keys[i].timeStamp + keys[i + 1].timeStamp) * 0.5f);
+		}
+		std::sort(times.begin(), times.end());
+	}
+
+	static void Locate(const std::vector<PackedKey>& keys, float time, int& cursor, int& outIndex, float& outAlpha)
+	{
+		outIndex = 0;
+		outAlpha = 0.0f;
+		if (keys.size() < 2)
+			return;
+
+		outIndex = Bone::FindKeyIndex(keys, time, cursor);
+		float span = (float)keys[outIndex + 1].timeStamp - keys[outIndex].timeStamp;
+		if (span > 0.0f)
+			outAlpha = glm::clamp((time - keys[outIndex].timeStamp) / span, 0.0f, 1.0f);
+	}
+
+	uint16_t QuantizeTime(float timeStamp) const
+	{
+		return QuantizeUnit(timeStamp * m_TimeScale / 65535.0f, 65535);
+	}
+
+	static inline uint16_t QuantizeUnit(float x, int maxValue)
+	{
+		return (uint16_t)(glm::clamp(x, 0.0f, 1.0f) * maxValue + 0.5f);
+	}
+
+	static PackedKey EncodeVec3(const glm::vec3& v, const glm::vec3& rangeMin, const glm::vec3& extent)
+	{
+		PackedKey key;
+		key.timeStamp = 0;
+		for (int i = 0; i < 3; i++)
+			key.value[i] = extent[i] > 0.0f ? QuantizeUnit((v[i] - rangeMin[i]) / extent[i], 65535) : 0;
+		return key;
+	}
+
+	static glm::vec3 DecodeVec3(const PackedKey& key, const glm::vec3& rangeMin, const glm::vec3& extent)
+	{
+		return rangeMin + glm::vec3(key.value[0], key.value[1], key.value[2]) * (extent / 65535.0f);
+	}
+
+	// Smallest three: the largest component is dropped and rebuilt from the unit
+	// length; its index takes 2 bits and the other three components 15 bits each,
+	// mapped from [-1/sqrt(2), 1/sqrt(2)]
+	static PackedKey EncodeQuat(const glm::quat& q)
+	{
+		float c[4] = { q.x, q.y, q.z, q.w };
+		int largest = 0;
+		for (int i = 1; i < 4; i++)
+			if (std::fabs(c[i]) > std::fabs(c[largest]))
+				largest = i;
+		float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+		uint64_t bits = (uint64_t)largest;
+		for (int i = 0; i < 4; i++)
+			if (i != largest)
+				bits = (bits << 15) | QuantizeUnit(c[i] * sign * 0.70710678f + 0.5f, 32767);
+
+		PackedKey key;
+		key.value[0] = (uint16_t)(bits >> 32);
+		key.value[1] = (uint16_t)(bits >> 16);
+		key.value[2] = (uint16_t)bits;
+		key.timeStamp = 0;
+		return key;
+	}
+
+	static glm::quat DecodeQuat(const PackedKey& key)
+	{
+		uint64_t bits = ((uint64_t)key.value[0] << 32) | ((uint64_t)key.value[1] << 16) | key.value[2];
+		int largest = (int)(bits >> 45) & 3;
+
+		float c[4];
+		float sum = 0.0f;
+		int shift = 30;
+		for (int i = 0; i < 4; i++)
+		{
+			if (i == largest)
+				continue;
+			c[i] = (((bits >> shift) & 0x7FFF) / 32767.0f - 0.5f) * 1.41421356f;
+			sum += c[i] * c[i];
+			shift -= 15;
+		}
+		c[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+		return glm::quat(c[3], c[0], c[1], c[2]);
+	}
+
+	std::vector<CompressedChannel> m_Channels;
+	float m_TimeScale = 0.0f;	// key time to 16-bit time steps
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+/* Animates many instances that share read-only Animation clips. Each instance only
+   owns its playback state (clip, time, speed) and key cursors; clip data is never
+   written during an update. Instances are evaluated in parallel on a ThreadPool
+   and their skinning matrices go into one contiguous buffer, MAX_BONES per
+   instance, ready to upload in one go. */
+
+#include <vector>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <learnopengl/animator.h>
+#include <learnopengl/thread_pool.h>
+
+struct CrowdInstance
+{
+    const Animation* clip;
+    float time;     // ticks
+    float speed;    // playback rate, 1 = clip speed
+};
+
+class CrowdAnimator
+{
+public:
+    static const int MAX_BONES = 100;   // matches finalBonesMatrices in anim_model.vs
+
+    int AddInstance(const Animation* clip, float startTime = 0.0f, float speed = 1.0f)
+    {
+        m_Instances.push_back(CrowdInstance{ clip, startTime, speed });
+        m_Cursors.emplace_back(clip ? clip->GetBones().size() : 0, BoneCursor());
+        m_Matrices.resize(m_Instances.size() * MAX_BONES, glm::mat4(1.0f));
+        return (int)m_Instances.size() - 1;
+    }
+
+    void SetClip(int instance, const Animation* clip, float startTime = 0.0f)
+    {
+        m_Instances[instance].clip = clip;
+        m_Instances[instance].time = startTime;
+        m_Cursors[instance].assign(clip ? clip->GetBones().size() : 0, BoneCursor());
+    }
+
+    inline void SetSpeed(int instance, float speed) { m_Instances[instance].speed = speed; }
+
+    // Advances and evaluates every instance; pool may be null to run on the calling thread
+    void Update(float dt, ThreadPool* pool = nullptr)
+    {
+        auto updateRange = [this, dt](size_t begin, size_t end)
+            {
+                // one scratch per thread, reused across frames
+                static thread_local PoseScratch scratch;
+                for (size_t i = begin; i < end; i++)
+                    UpdateInstance(i, dt, scratch);
+            };
+
+        const size_t INSTANCES_PER_JOB = 8;
+        if (pool)
+            pool->ParallelFor(m_Instances.size(), INSTANCES_PER_JOB, updateRange);
+        else
+            updateRange(0, m_Instances.size());
+    }
+
+    inline BoneMatrixView GetBoneMatrices(int instance) const
+    {
+        return BoneMatrixView{ m_Matrices.data() + (size_t)instance * MAX_BONES, (size_t)MAX_BONES };
+    }
+
+    // All instances' matrices, instance i at [i * MAX_BONES, (i + 1) * MAX_BONES)
+    inline const glm::mat4* GetMatrixBuffer() const { return m_Matrices.data(); }
+    inline const CrowdInstance& GetInstance(int instance) const { return m_Instances[instance]; }
+    inline int GetInstanceCount() const { return (int)m_Instances.size(); }
+
+private:
+    void UpdateInstance(size_t i, float dt, PoseScratch& scratch)
+    {
+        CrowdInstance& instance = m_Instances[i];
+        const Animation* clip = instance.clip;
+        if (!clip)
+            return;
+
+        // same looping as Animator::UpdateAnimation
+        instance.time += clip->GetTicksPerSecond() * instance.speed * dt;
+        if (instance.time >= clip->GetDuration())
+            instance.time = clip->GetLoopKey();
+        instance.time = fmod(instance.time, clip->GetDuration());
+
+        if (const BakedPoseTable* baked = clip->GetBakedPoses())
+            baked->Sample(instance.time, &m_Matrices[i * MAX_BONES], MAX_BONES);
+        else
+            EvaluateAnimationPose(*clip, instance.time, m_Cursors[i], scratch,
+                &m_Matrices[i * MAX_BONES], MAX_BONES);
+    }
+
+    std::vector<CrowdInstance> m_Instances;
+    std::vector<std::vector<BoneCursor>> m_Cursors;
+    std::vector<glm::mat4> m_Matrices;
+};
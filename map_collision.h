@@ -0,0 +1,71 @@
+#pragma once
+
+/* Sphere-vs-map collision used by the player and by agent batches. Both functions
+   take any broadphase exposing QuerySphereLeaves (CollisionBVH, CollisionGrid,
+   CollisionCandidates). */
+
+#include <glm/glm.hpp>
+#include <learnopengl/collision_mesh.h>
+#include <learnopengl/collision_bvh.h>
+#include <learnopengl/collision_simd.h>
+#include <learnopengl/collision_raycast.h>
+
+template <typename Broadphase>
+bool CheckMapCollision(const glm::vec3& pos, float radius, const CollisionMesh& mapMesh, const Broadphase& broadphase)
+{
+	return broadphase.QuerySphereLeaves(pos, radius, [&](int first, int count)
+		{
+			glm::vec3 closest[CollisionBVH::MAX_LEAF_TRIANGLES];
+			return TestSphereTriangles(pos, radius, mapMesh, first, count, closest) != 0;
+		});
+}
+
+template <typename Broadphase>
+float ResolveVerticalCollision(glm::vec3& pos, float radius, const CollisionMesh& mapMesh, const Broadphase& broadphase, float currentVelocityY)
+{
+	float floorY = -9999.0f;
+	bool foundFloor = false;
+
+	broadphase.QuerySphereLeaves(pos, radius, [&](int first, int count)
+		{
+			glm::vec3 closest[CollisionBVH::MAX_LEAF_TRIANGLES];
+			unsigned int hits = TestSphereTriangles(pos, radius, mapMesh, first, count, closest);
+
+			for (int i = 0; i < count; i++)
+			{
+				if ((hits & (1u << i)) && closest[i].y < pos.y)
+				{
+					if (closest[i].y > floorY)
+					{
+						floorY = closest[i].y;
+						foundFloor = true;
+					}
+				}
+			}
+			return false;
+		});
+
+	if (foundFloor)
+	{
+		float newY = floorY + radius;
+		pos.y = newY;
+
+		return 0.0f; // reset ความเร็ว Y
+	}
+
+	return currentVelocityY;
+}
+
+// Cheaper floor resolution: a single downward ray from the sphere centre instead of
+// sphere overlap tests against every nearby triangle
+inline float ResolveVerticalRaycast(glm::vec3& pos, float radius, const CollisionMesh& mapMesh, const CollisionBVH& mapBVH, float currentVelocityY)
+{
+	FloorHit hit;
+	if (QueryFloorHeight(mapMesh, mapBVH, pos, radius, hit))
+	{
+		pos.y = hit.height + radius;
+		return 0.0f;
+	}
+
+	return currentVelocityY;
+}
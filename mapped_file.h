@@ -0,0 +1,248 @@
+#pragma once
+
+/* Read-only memory mapping of a whole file, plus the source stamp used to validate
+   baked caches against their source assets */
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path)
+    {
+        Close();
+
+#ifdef _WIN32
+        m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_File == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+        {
+            Close();
+            return false;
+        }
+        m_Size = (size_t)size.QuadPart;
+
+        m_Mapping = CreateFileMappingA(m_File, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!m_Mapping)
+        {
+            Close();
+            return false;
+        }
+
+        m_Data = (const unsigned char*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+        m_Size = (size_t)st.st_size;
+
+        void* data = mmap(NULL, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        m_Data = data == MAP_FAILED ? nullptr : (const unsigned char*)data;
+#endif
+
+        if (!m_Data)
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+        if (m_Data) UnmapViewOfFile(m_Data);
+        if (m_Mapping) CloseHandle(m_Mapping);
+        if (m_File != INVALID_HANDLE_VALUE) CloseHandle(m_File);
+        m_Mapping = NULL;
+        m_File = INVALID_HANDLE_VALUE;
+#else
+        if (m_Data) munmap((void*)m_Data, m_Size);
+#endif
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+
+    inline bool IsOpen() const { return m_Data != nullptr; }
+    inline const unsigned char* GetData() const { return m_Data; }
+    inline size_t GetSize() const { return m_Size; }
+
+private:
+    const unsigned char* m_Data = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    HANDLE m_File = INVALID_HANDLE_VALUE;
+    HANDLE m_Mapping = NULL;
+#endif
+};
+
+// 64-bit FNV-1a
+inline uint64_t HashBytes(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline bool HashFile(const std::string& path, uint64_t& outHash)
+{
+    MappedFile file;
+    if (!file.Open(path))
+        return false;
+
+    outHash = HashBytes(file.GetData(), file.GetSize());
+    return true;
+}
+
+// Touches every page of path so the OS keeps the file cached, for a loader that has
+// to run on another thread (e.g. the GL one) not to wait on the disk for it
+inline bool PrefetchFile(const std::string& path)
+{
+    MappedFile file;
+    if (!file.Open(path))
+        return false;
+
+    unsigned char sum = 0;
+    for (size_t i = 0; i < file.GetSize(); i += 4096)
+        sum ^= file.GetData()[i];
+    volatile unsigned char sink = sum;
+    (void)sink;
+    return true;
+}
+
+inline bool StatFile(const std::string& path, uint64_t& outSize, int64_t& outModified)
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0)
+        return false;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+#endif
+    outSize = (uint64_t)st.st_size;
+    outModified = (int64_t)st.st_mtime;
+    return true;
+}
+
+// What a cache records about the asset it was baked from
+struct SourceStamp
+{
+    uint64_t hash;
+    uint64_t size;
+    int64_t modified;       // seconds since the epoch
+};
+
+// One source asset as seen by every cache baked from it. The file is stat'ed once and
+// read at most once however many caches check or stamp it, so it must not change while
+// the object is in use. Not synchronised: hand it from task to task, not to two at once.
+class SourceFile
+{
+public:
+    explicit SourceFile(const std::string& path)
+        : m_Path(path)
+    {
+    }
+
+    inline const std::string& GetPath() const { return m_Path; }
+
+    // A source whose size and modification time are unchanged is taken as unchanged
+    // without reading it; otherwise the content hash decides, so a copy or checkout
+    // that only touched the time still matches
+    bool IsCurrent(const SourceStamp& recorded)
+    {
+        if (!Stat() || m_Stamp.size != recorded.size)
+            return false;
+        if (m_Stamp.modified == recorded.modified)
+            return true;
+        return Hash() && m_Stamp.hash == recorded.hash;
+    }
+
+    bool Stamp(SourceStamp& outStamp)
+    {
+        if (!Stat() || !Hash())
+            return false;
+        outStamp = m_Stamp;
+        return true;
+    }
+
+private:
+    bool Stat()
+    {
+        if (!m_Stated)
+        {
+            m_StatOk = StatFile(m_Path, m_Stamp.size, m_Stamp.modified);
+            m_Stated = true;
+        }
+        return m_StatOk;
+    }
+
+    bool Hash()
+    {
+        if (!m_Hashed)
+        {
+            m_HashOk = HashFile(m_Path, m_Stamp.hash);
+            m_Hashed = true;
+        }
+        return m_HashOk;
+    }
+
+    std::string m_Path;
+    SourceStamp m_Stamp = {};
+    bool m_Stated = false;
+    bool m_StatOk = false;
+    bool m_Hashed = false;
+    bool m_HashOk = false;
+};
+
+inline bool StampFile(const std::string& path, SourceStamp& outStamp)
+{
+    return SourceFile(path).Stamp(outStamp);
+}
+
+// See SourceFile::IsCurrent
+inline bool IsSourceCurrent(const std::string& path, const SourceStamp& recorded)
+{
+    return SourceFile(path).IsCurrent(recorded);
+}
@@ -0,0 +1,367 @@
+#pragma once
+
+/* Compact GPU copies of a Model's meshes. Each mesh gets its own VAO, vertex and
+   index buffers in a packed layout chosen by whether the mesh is skinned:
+
+     static   24 bytes  position float3, normal and tangent snorm 10:10:10:2,
+                        uv half2
+     skinned  32 bytes  the above, then bone ids uint8x4 and weights unorm8x4
+
+   against 88 bytes for the Vertex the Model uploads. The tangent's w holds the
+   bitangent's handedness, so the bitangent is not stored. Bone slots without an
+   influence get id NO_BONE and weight 0; shaders reading packed skinned vertices
+   are built with PACKED_VERTEX so they recognise it. Indices are 16-bit when the
+   mesh has few enough vertices. A model with a mesh whose bone ids do not fit in
+   uint8 is not packed at all, so it is never half drawn with the wrong shader.
+   Once packed, the Model's own GPU buffers are released; its CPU-side vertices
+   stay, for collision and the memory figures. */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/model_animation.h>
+
+struct PackedVertex
+{
+    float position[3];
+    uint32_t normal;        // snorm 10:10:10:2, w unused
+    uint32_t tangent;       // snorm 10:10:10:2, w = bitangent handedness
+    uint16_t uv[2];         // half float
+};
+
+struct PackedSkinnedVertex
+{
+    PackedVertex base;
+    uint8_t boneIds[4];
+    uint8_t weights[4];     // unorm8, summing to 255
+};
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex must stay tightly packed");
+static_assert(sizeof(PackedSkinnedVertex) == 32, "PackedSkinnedVertex must stay tightly packed");
+
+// Round to nearest half float; overflow goes to infinity, tiny values to signed zero
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+    if (magnitude >= 0x7F800000u)   // inf or nan
+        return (uint16_t)(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+    if (magnitude >= 0x477FF000u)   // rounds past the largest half
+        return (uint16_t)(sign | 0x7C00u);
+    if (magnitude < 0x33000000u)    // below half the smallest subnormal
+        return (uint16_t)sign;
+
+    int exponent = (int)(magnitude >> 23) - 127 + 15;
+    uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+    int shift = exponent > 0 ? 13 : 14 - exponent;     // subnormals lose more bits
+    uint32_t half = mantissa >> shift;
+    uint32_t rest = mantissa & ((1u << shift) - 1u);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1u)))
+        half++;
+
+    // normal numbers: the implicit bit carries into the exponent field, which is what a
+    // mantissa overflow from rounding needs as well
+    if (exponent > 0)
+        half += (uint32_t)(exponent - 1) << 10;
+    return (uint16_t)(sign | half);
+}
+
+inline uint32_t PackSnorm1010102(const glm::vec3& v, float w)
+{
+    auto component = [](float x, float scale, uint32_t mask)
+        {
+            float clamped = std::min(std::max(x, -1.0f), 1.0f);
+            return (uint32_t)(int32_t)std::lround(clamped * scale) & mask;
+        };
+    return component(v.x, 511.0f, 0x3FFu)
+        | component(v.y, 511.0f, 0x3FFu) << 10
+        | component(v.z, 511.0f, 0x3FFu) << 20
+        | component(w, 1.0f, 0x3u) << 30;
+}
+
+class PackedModel
+{
+public:
+    static const uint8_t NO_BONE = 255;
+
+    PackedModel() = default;
+    PackedModel(const PackedModel&) = delete;
+    PackedModel& operator=(const PackedModel&) = delete;
+
+    // Packs and uploads every mesh, then frees the model's own buffers; needs a
+    // current GL context. Returns false, leaving the model untouched, when a mesh
+    // can not be packed; the model must then be drawn itself, with shaders built
+    // without PACKED_VERTEX. The model must outlive this, its meshes' textures are
+    // used when drawing.
+    bool Build(Model& model)
+    {
+        m_Meshes.clear();
+        if (!IsPackable(model))
+            return false;
+
+        m_Meshes.reserve(model.meshes.size());
+        for (Mesh& mesh : model.meshes)
+        {
+            PackedMesh packed;
+            packed.source = &mesh;
+            packed.skinned = IsSkinned(mesh);
+            Upload(mesh, packed);
+            ReleaseSourceBuffers(mesh);
+            m_Meshes.push_back(packed);
+        }
+        return true;
+    }
+
+    // Same texture binding as Mesh::Draw, then the packed buffers
+    void Draw(Shader& shader) const
+    {
+        for (const PackedMesh& packed : m_Meshes)
+        {
+            BindTextures(*packed.source, shader);
+
+            // generic attribute values are context state: a skinned shader drawing a
+            // static mesh must see no influences rather than whatever was set last
+            if (!packed.skinned)
+            {
+                glVertexAttribI4i(5, NO_BONE, NO_BONE, NO_BONE, NO_BONE);
+                glVertexAttrib4f(6, 0.0f, 0.0f, 0.0f, 0.0f);
+            }
+
+            glBindVertexArray(packed.VAO);
+            glDrawElements(GL_TRIANGLES, packed.indexCount, packed.indexType, 0);
+            glBindVertexArray(0);
+            glActiveTexture(GL_TEXTURE0);
+        }
+    }
+
+    size_t GetVertexMemoryUsage() const
+    {
+        size_t bytes = 0;
+        for (const PackedMesh& packed : m_Meshes)
+            bytes += packed.vertexBytes;
+        return bytes;
+    }
+
+    size_t GetIndexMemoryUsage() const
+    {
+        size_t bytes = 0;
+        for (const PackedMesh& packed : m_Meshes)
+            bytes += packed.indexBytes;
+        return bytes;
+    }
+
+    int GetSkinnedMeshCount() const
+    {
+        int count = 0;
+        for (const PackedMesh& packed : m_Meshes)
+            count += packed.skinned ? 1 : 0;
+        return count;
+    }
+
+    // Whether every mesh's bone ids fit in the packed uint8 slots
+    static bool IsPackable(const Model& model)
+    {
+        for (const Mesh& mesh : model.meshes)
+            if (!IsPackable(mesh))
+                return false;
+        return true;
+    }
+
+    inline int GetMeshCount() const { return (int)m_Meshes.size(); }
+    inline bool IsBuilt() const { return !m_Meshes.empty(); }
+
+    // Bytes the Model itself uploads, for comparison
+    static size_t GetSourceVertexMemoryUsage(const Model& model)
+    {
+        size_t bytes = 0;
+        for (const Mesh& mesh : model.meshes)
+            bytes += mesh.vertices.size() * sizeof(Vertex);
+        return bytes;
+    }
+
+    static size_t GetSourceIndexMemoryUsage(const Model& model)
+    {
+        size_t bytes = 0;
+        for (const Mesh& mesh : model.meshes)
+            bytes += mesh.indices.size() * sizeof(unsigned int);
+        return bytes;
+    }
+
+private:
+    struct PackedMesh
+    {
+        Mesh* source = nullptr;
+        bool skinned = false;
+        unsigned int VAO = 0;
+        unsigned int VBO = 0;
+        unsigned int EBO = 0;
+        GLsizei indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+        size_t vertexBytes = 0;
+        size_t indexBytes = 0;
+    };
+
+    static bool IsSkinned(const Mesh& mesh)
+    {
+        for (const Vertex& vertex : mesh.vertices)
+            for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+                if (vertex.m_BoneIDs[i] >= 0 && vertex.m_Weights[i] > 0.0f)
+                    return true;
+        return false;
+    }
+
+    static bool IsPackable(const Mesh& mesh)
+    {
+        for (const Vertex& vertex : mesh.vertices)
+            for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+                if (vertex.m_BoneIDs[i] >= NO_BONE)
+                    return false;
+        return true;
+    }
+
+    static PackedVertex PackBase(const Vertex& vertex)
+    {
+        PackedVertex packed;
+        packed.position[0] = vertex.Position.x;
+        packed.position[1] = vertex.Position.y;
+        packed.position[2] = vertex.Position.z;
+        packed.normal = PackSnorm1010102(vertex.Normal, 0.0f);
+
+        // handedness of the stored bitangent against the one cross(N, T) gives
+        float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        packed.tangent = PackSnorm1010102(vertex.Tangent, handedness);
+
+        packed.uv[0] = FloatToHalf(vertex.TexCoords.x);
+        packed.uv[1] = FloatToHalf(vertex.TexCoords.y);
+        return packed;
+    }
+
+    // Weights quantised to unorm8 with the rounding error put on the largest, so an
+    // influenced vertex still sums to exactly 1
+    static void PackInfluences(const Vertex& vertex, PackedSkinnedVertex& out)
+    {
+        int total = 0, largest = -1;
+        for (int i = 0; i < 4; i++)
+        {
+            bool used = i < MAX_BONE_INFLUENCE && vertex.m_BoneIDs[i] >= 0 && vertex.m_Weights[i] > 0.0f;
+            out.boneIds[i] = used ? (uint8_t)vertex.m_BoneIDs[i] : NO_BONE;
+            out.weights[i] = used ? (uint8_t)std::lround(std::min(vertex.m_Weights[i], 1.0f) * 255.0f) : 0;
+            total += out.weights[i];
+            if (used && (largest < 0 || out.weights[i] > out.weights[largest]))
+                largest = i;
+        }
+        if (largest >= 0 && total > 0)
+            out.weights[largest] = (uint8_t)std::min(std::max(out.weights[largest] + 255 - total, 0), 255);
+    }
+
+    static void Upload(const Mesh& mesh, PackedMesh& packed)
+    {
+        size_t stride = packed.skinned ? sizeof(PackedSkinnedVertex) : sizeof(PackedVertex);
+        std::vector<unsigned char> vertices(mesh.vertices.size() * stride);
+        for (size_t v = 0; v < mesh.vertices.size(); v++)
+        {
+            PackedSkinnedVertex out;
+            out.base = PackBase(mesh.vertices[v]);
+            if (packed.skinned)
+                PackInfluences(mesh.vertices[v], out);
+            memcpy(&vertices[v * stride], &out, stride);
+        }
+
+        packed.indexCount = (GLsizei)mesh.indices.size();
+        std::vector<uint16_t> shortIndices;
+        const void* indexData = mesh.indices.data();
+        packed.indexBytes = mesh.indices.size() * sizeof(unsigned int);
+        packed.indexType = GL_UNSIGNED_INT;
+        if (mesh.vertices.size() <= 65536)
+        {
+            shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+            indexData = shortIndices.data();
+            packed.indexBytes = shortIndices.size() * sizeof(uint16_t);
+            packed.indexType = GL_UNSIGNED_SHORT;
+        }
+        packed.vertexBytes = vertices.size();
+
+        glGenVertexArrays(1, &packed.VAO);
+        glGenBuffers(1, &packed.VBO);
+        glGenBuffers(1, &packed.EBO);
+        glBindVertexArray(packed.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, packed.VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, packed.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.indexBytes, indexData, GL_STATIC_DRAW);
+
+        // same locations as Mesh; the bitangent (4) is left disabled
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)offsetof(PackedVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, (GLsizei)stride, (void*)offsetof(PackedVertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, (GLsizei)stride, (void*)offsetof(PackedVertex, uv));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, (GLsizei)stride, (void*)offsetof(PackedVertex, tangent));
+        if (packed.skinned)
+        {
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, (GLsizei)stride, (void*)offsetof(PackedSkinnedVertex, boneIds));
+            glEnableVertexAttribArray(6);
+            glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, (GLsizei)stride, (void*)offsetof(PackedSkinnedVertex, weights));
+        }
+        glBindVertexArray(0);
+    }
+
+    // Deletes the VAO, vertex and index buffers Mesh created. Mesh keeps the buffer
+    // names private, so they are read back from the VAO that references them.
+    static void ReleaseSourceBuffers(Mesh& mesh)
+    {
+        if (mesh.VAO == 0)
+            return;
+
+        GLint vertexBuffer = 0, indexBuffer = 0;
+        glBindVertexArray(mesh.VAO);
+        glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &vertexBuffer);
+        glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &indexBuffer);
+        glBindVertexArray(0);
+
+        GLuint buffers[2] = { (GLuint)vertexBuffer, (GLuint)indexBuffer };
+        glDeleteBuffers(2, buffers);
+        glDeleteVertexArrays(1, &mesh.VAO);
+        mesh.VAO = 0;
+    }
+
+    static void BindTextures(const Mesh& mesh, Shader& shader)
+    {
+        unsigned int diffuseNr = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr = 1;
+        unsigned int heightNr = 1;
+        for (unsigned int i = 0; i < mesh.textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i);
+            std::string number;
+            const std::string& name = mesh.textures[i].type;
+            if (name == "texture_diffuse")
+                number = std::to_string(diffuseNr++);
+            else if (name == "texture_specular")
+                number = std::to_string(specularNr++);
+            else if (name == "texture_normal")
+                number = std::to_string(normalNr++);
+            else if (name == "texture_height")
+                number = std::to_string(heightNr++);
+
+            shader.setInt(name + number, i);
+            glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
+        }
+    }
+
+    std::vector<PackedMesh> m_Meshes;
+};
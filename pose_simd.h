@@ -0,0 +1,259 @@
+#pragma once
+
+/* Pose kernels that work on many bones at once. Local transforms are kept as one
+   float stream per component, so 4 (SSE) or 8 (AVX) bones fill a register; they
+   are blended (lerp, nlerp for rotations) and composed straight into 3x4 affine
+   matrices instead of multiplying separate translate, rotate and scale 4x4s.
+   Hierarchy multiplies use the 3x4 form with one SSE register per row.
+   Without SSE every kernel runs its scalar version. */
+
+#include <vector>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <learnopengl/simd.h>
+
+// Row-major affine transform; the implied fourth row is (0, 0, 0, 1)
+struct Affine3x4
+{
+	float m[3][4];
+};
+
+inline Affine3x4 AffineFromMat4(const glm::mat4& mat)
+{
+	Affine3x4 a;
+	for (int r = 0; r < 3; r++)
+		for (int c = 0; c < 4; c++)
+			a.m[r][c] = mat[c][r];
+	return a;
+}
+
+inline void AffineToMat4(const Affine3x4& a, glm::mat4& out)
+{
+	for (int c = 0; c < 4; c++)
+		out[c] = glm::vec4(a.m[0][c], a.m[1][c], a.m[2][c], c == 3 ? 1.0f : 0.0f);
+}
+
+// out = a * b; out may alias a or b
+inline void MultiplyAffine(const Affine3x4& a, const Affine3x4& b, Affine3x4& out)
+{
+#if SIMD_WIDTH >= 4
+	const __m128 b0 = _mm_loadu_ps(b.m[0]);
+	const __m128 b1 = _mm_loadu_ps(b.m[1]);
+	const __m128 b2 = _mm_loadu_ps(b.m[2]);
+	const __m128 b3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+	for (int r = 0; r < 3; r++)
+	{
+		__m128 row = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.m[r][0]), b0), _mm_mul_ps(_mm_set1_ps(a.m[r][1]), b1)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.m[r][2]), b2), _mm_mul_ps(_mm_set1_ps(a.m[r][3]), b3)));
+		_mm_storeu_ps(out.m[r], row);
+	}
+#else
+	Affine3x4 result;
+	for (int r = 0; r < 3; r++)
+	{
+		for (int c = 0; c < 4; c++)
+			result.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c];
+		result.m[r][3] += a.m[r][3];
+	}
+	out = result;
+#endif
+}
+
+// Local translation, rotation and scale of each channel as one float stream per
+// component. Streams are padded to a multiple of 8 with the identity transform.
+class LocalPose
+{
+public:
+	enum Stream
+	{
+		TX, TY, TZ,
+		RX, RY, RZ, RW,
+		SX, SY, SZ,
+		STREAM_COUNT
+	};
+
+	void Resize(int count)
+	{
+		m_Count = count;
+		size_t padded = (size_t)(count + 7) & ~(size_t)7;
+		for (int s = 0; s < STREAM_COUNT; s++)
+			m_Streams[s].resize(padded, s == RW || s >= SX ? 1.0f : 0.0f);
+	}
+
+	inline void Set(int i, const glm::vec3& t, const glm::quat& r, const glm::vec3& s)
+	{
+		m_Streams[TX][i] = t.x; m_Streams[TY][i] = t.y; m_Streams[TZ][i] = t.z;
+		m_Streams[RX][i] = r.x; m_Streams[RY][i] = r.y; m_Streams[RZ][i] = r.z; m_Streams[RW][i] = r.w;
+		m_Streams[SX][i] = s.x; m_Streams[SY][i] = s.y; m_Streams[SZ][i] = s.z;
+	}
+
+	inline glm::vec3 GetTranslation(int i) const { return glm::vec3(m_Streams[TX][i], m_Streams[TY][i], m_Streams[TZ][i]); }
+	inline glm::quat GetRotation(int i) const { return glm::quat(m_Streams[RW][i], m_Streams[RX][i], m_Streams[RY][i], m_Streams[RZ][i]); }
+	inline glm::vec3 GetScale(int i) const { return glm::vec3(m_Streams[SX][i], m_Streams[SY][i], m_Streams[SZ][i]); }
+
+	inline float* GetStream(int s) { return m_Streams[s].data(); }
+	inline const float* GetStream(int s) const { return m_Streams[s].data(); }
+	inline int GetCount() const { return m_Count; }
+
+private:
+	std::vector<float> m_Streams[STREAM_COUNT];
+	int m_Count = 0;
+};
+
+// Channel i of out = blend of channel i of a and b: translation and scale lerp,
+// rotation nlerp along the shorter arc. a, b and out hold LocalPose::STREAM_COUNT
+// stream pointers each.
+inline void BlendPoseScalar(const float* const* a, const float* const* b, float alpha, int i, float* const* out)
+{
+	const int vectors[] = { LocalPose::TX, LocalPose::TY, LocalPose::TZ, LocalPose::SX, LocalPose::SY, LocalPose::SZ };
+	for (int s : vectors)
+		out[s][i] = a[s][i] + (b[s][i] - a[s][i]) * alpha;
+
+	float d = 0.0f;
+	for (int s = LocalPose::RX; s <= LocalPose::RW; s++)
+		d += a[s][i] * b[s][i];
+	float sign = d < 0.0f ? -1.0f : 1.0f;
+
+	float q[4];
+	float len2 = 0.0f;
+	for (int s = LocalPose::RX; s <= LocalPose::RW; s++)
+	{
+		q[s - LocalPose::RX] = a[s][i] + (b[s][i] * sign - a[s][i]) * alpha;
+		len2 += q[s - LocalPose::RX] * q[s - LocalPose::RX];
+	}
+	float invLen = 1.0f / std::sqrt(len2);
+	for (int s = LocalPose::RX; s <= LocalPose::RW; s++)
+		out[s][i] = q[s - LocalPose::RX] * invLen;
+}
+
+template <typename S>
+inline void BlendPosePacket(const float* const* a, const float* const* b, float alpha, int i, float* const* out)
+{
+	typedef typename S::Reg Reg;
+	const Reg t = S::Set1(alpha);
+	const Reg zero = S::Set1(0.0f);
+
+	const int vectors[] = { LocalPose::TX, LocalPose::TY, LocalPose::TZ, LocalPose::SX, LocalPose::SY, LocalPose::SZ };
+	for (int s : vectors)
+	{
+		Reg x = S::Load(a[s] + i);
+		S::Store(out[s] + i, S::Add(x, S::Mul(S::Sub(S::Load(b[s] + i), x), t)));
+	}
+
+	Reg ax = S::Load(a[LocalPose::RX] + i), ay = S::Load(a[LocalPose::RY] + i);
+	Reg az = S::Load(a[LocalPose::RZ] + i), aw = S::Load(a[LocalPose::RW] + i);
+	Reg bx = S::Load(b[LocalPose::RX] + i), by = S::Load(b[LocalPose::RY] + i);
+	Reg bz = S::Load(b[LocalPose::RZ] + i), bw = S::Load(b[LocalPose::RW] + i);
+
+	Reg d = S::Add(S::Add(S::Mul(ax, bx), S::Mul(ay, by)), S::Add(S::Mul(az, bz), S::Mul(aw, bw)));
+	Reg flip = S::Lt(d, zero);
+	bx = S::Select(flip, S::Sub(zero, bx), bx);
+	by = S::Select(flip, S::Sub(zero, by), by);
+	bz = S::Select(flip, S::Sub(zero, bz), bz);
+	bw = S::Select(flip, S::Sub(zero, bw), bw);
+
+	Reg qx = S::Add(ax, S::Mul(S::Sub(bx, ax), t));
+	Reg qy = S::Add(ay, S::Mul(S::Sub(by, ay), t));
+	Reg qz = S::Add(az, S::Mul(S::Sub(bz, az), t));
+	Reg qw = S::Add(aw, S::Mul(S::Sub(bw, aw), t));
+	Reg len2 = S::Add(S::Add(S::Mul(qx, qx), S::Mul(qy, qy)), S::Add(S::Mul(qz, qz), S::Mul(qw, qw)));
+	Reg invLen = S::Div(S::Set1(1.0f), S::Sqrt(len2));
+
+	S::Store(out[LocalPose::RX] + i, S::Mul(qx, invLen));
+	S::Store(out[LocalPose::RY] + i, S::Mul(qy, invLen));
+	S::Store(out[LocalPose::RZ] + i, S::Mul(qz, invLen));
+	S::Store(out[LocalPose::RW] + i, S::Mul(qw, invLen));
+}
+
+// Blends channels [0, count); loads never read past count
+inline void BlendPoses(const float* const* a, const float* const* b, float alpha, int count, float* const* out)
+{
+	int i = 0;
+#if SIMD_WIDTH >= 8
+	for (; i + 8 <= count; i += 8)
+		BlendPosePacket<SimdAVX>(a, b, alpha, i, out);
+#endif
+#if SIMD_WIDTH >= 4
+	for (; i + 4 <= count; i += 4)
+		BlendPosePacket<SimdSSE>(a, b, alpha, i, out);
+#endif
+	for (; i < count; i++)
+		BlendPoseScalar(a, b, alpha, i, out);
+}
+
+// T * R * S as a 3x4, same as glm::translate * glm::toMat4 * glm::scale for a unit
+// quaternion
+inline void ComposeAffineScalar(const LocalPose& pose, int i, Affine3x4& out)
+{
+	const float* const t[3] = { pose.GetStream(LocalPose::TX), pose.GetStream(LocalPose::TY), pose.GetStream(LocalPose::TZ) };
+	float x = pose.GetStream(LocalPose::RX)[i], y = pose.GetStream(LocalPose::RY)[i];
+	float z = pose.GetStream(LocalPose::RZ)[i], w = pose.GetStream(LocalPose::RW)[i];
+	float sx = pose.GetStream(LocalPose::SX)[i], sy = pose.GetStream(LocalPose::SY)[i], sz = pose.GetStream(LocalPose::SZ)[i];
+
+	float x2 = x + x, y2 = y + y, z2 = z + z;
+	float xx = x * x2, yy = y * y2, zz = z * z2;
+	float xy = x * y2, xz = x * z2, yz = y * z2;
+	float wx = w * x2, wy = w * y2, wz = w * z2;
+
+	out.m[0][0] = (1.0f - (yy + zz)) * sx; out.m[0][1] = (xy - wz) * sy; out.m[0][2] = (xz + wy) * sz; out.m[0][3] = t[0][i];
+	out.m[1][0] = (xy + wz) * sx; out.m[1][1] = (1.0f - (xx + zz)) * sy; out.m[1][2] = (yz - wx) * sz; out.m[1][3] = t[1][i];
+	out.m[2][0] = (xz - wy) * sx; out.m[2][1] = (yz + wx) * sy; out.m[2][2] = (1.0f - (xx + yy)) * sz; out.m[2][3] = t[2][i];
+}
+
+template <typename S>
+inline void ComposeAffinePacket(const LocalPose& pose, int i, Affine3x4* out)
+{
+	typedef typename S::Reg Reg;
+	const Reg one = S::Set1(1.0f);
+
+	Reg x = S::Load(pose.GetStream(LocalPose::RX) + i), y = S::Load(pose.GetStream(LocalPose::RY) + i);
+	Reg z = S::Load(pose.GetStream(LocalPose::RZ) + i), w = S::Load(pose.GetStream(LocalPose::RW) + i);
+	Reg sx = S::Load(pose.GetStream(LocalPose::SX) + i), sy = S::Load(pose.GetStream(LocalPose::SY) + i);
+	Reg sz = S::Load(pose.GetStream(LocalPose::SZ) + i);
+
+	Reg x2 = S::Add(x, x), y2 = S::Add(y, y), z2 = S::Add(z, z);
+	Reg xx = S::Mul(x, x2), yy = S::Mul(y, y2), zz = S::Mul(z, z2);
+	Reg xy = S::Mul(x, y2), xz = S::Mul(x, z2), yz = S::Mul(y, z2);
+	Reg wx = S::Mul(w, x2), wy = S::Mul(w, y2), wz = S::Mul(w, z2);
+
+	// element rows, stored lane by lane into the 3x4s
+	float m[12][S::WIDTH];
+	S::Store(m[0], S::Mul(S::Sub(one, S::Add(yy, zz)), sx));
+	S::Store(m[1], S::Mul(S::Sub(xy, wz), sy));
+	S::Store(m[2], S::Mul(S::Add(xz, wy), sz));
+	S::Store(m[3], S::Load(pose.GetStream(LocalPose::TX) + i));
+	S::Store(m[4], S::Mul(S::Add(xy, wz), sx));
+	S::Store(m[5], S::Mul(S::Sub(one, S::Add(xx, zz)), sy));
+	S::Store(m[6], S::Mul(S::Sub(yz, wx), sz));
+	S::Store(m[7], S::Load(pose.GetStream(LocalPose::TY) + i));
+	S::Store(m[8], S::Mul(S::Sub(xz, wy), sx));
+	S::Store(m[9], S::Mul(S::Add(yz, wx), sy));
+	S::Store(m[10], S::Mul(S::Sub(one, S::Add(xx, yy)), sz));
+	S::Store(m[11], S::Load(pose.GetStream(LocalPose::TZ) + i));
+
+	for (int lane = 0; lane < S::WIDTH; lane++)
+	{
+		float* dst = &out[lane].m[0][0];
+		for (int e = 0; e < 12; e++)
+			dst[e] = m[e][lane];
+	}
+}
+
+// Composes channels [0, pose.GetCount()) into out
+inline void ComposeAffine(const LocalPose& pose, Affine3x4* out)
+{
+	int count = pose.GetCount();
+	int i = 0;
+#if SIMD_WIDTH >= 8
+	for (; i + 8 <= count; i += 8)
+		ComposeAffinePacket<SimdAVX>(pose, i, out + i);
+#endif
+#if SIMD_WIDTH >= 4
+	for (; i + 4 <= count; i += 4)
+		ComposeAffinePacket<SimdSSE>(pose, i, out + i);
+#endif
+	for (; i < count; i++)
+		ComposeAffineScalar(pose, i, out[i]);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+/* Animation channels resampled at import time onto a uniform tick grid.
+   Every channel is stored in ten float streams (translation xyz, rotation xyzw,
+   scale xyz) laid out frame-major, so one frame of all bones is contiguous and a
+   sample is an index computation plus a lerp instead of a key search. Rotations
+   are made hemisphere-consistent while baking, so playback can nlerp directly. */
+
+#include <vector>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <learnopengl/bone.h>
+#include <learnopengl/pose_simd.h>
+#include <learnopengl/mapped_file.h>
+
+class ResampledClip
+{
+public:
+	enum Stream
+	{
+		TX, TY, TZ,
+		RX, RY, RZ, RW,
+		SX, SY, SZ,
+		STREAM_COUNT
+	};
+
+	// samplesPerTick is the grid density in animation ticks, e.g. 30 / ticksPerSecond
+	// for 30 samples per second
+	void Build(const std::vector<Bone>& bones, float duration, float samplesPerTick)
+	{
+		Build((int)bones.size(), duration, samplesPerTick,
+			[&bones](int channel, float time, BoneCursor& cursor, glm::vec3& t, glm::quat& r, glm::vec3& scale)
+			{
+				bones[channel].Sample(time, cursor, t, r, scale);
+			});
+	}
+
+	// Same, from any source with Bone::Sample's contract, called as
+	// sample(channel, time, cursor, t, r, scale), e.g. a CompressedClip
+	template <typename Sampler>
+	void Build(int channelCount, float duration, float samplesPerTick, Sampler&& sample)
+	{
+		m_ChannelCount = channelCount;
+		m_FrameCount = std::max(2, (int)std::ceil(duration * samplesPerTick) + 1);
+		m_TickStep = duration / (m_FrameCount - 1);
+		m_InvTickStep = m_TickStep > 0.0f ? 1.0f / m_TickStep : 0.0f;
+
+		for (int s = 0; s < STREAM_COUNT; s++)
+			m_Streams[s].assign((size_t)m_FrameCount * m_ChannelCount, 0.0f);
+
+		for (int c = 0; c < m_ChannelCount; c++)
+		{
+			BoneCursor cursor;
+			glm::quat previous(1.0f, 0.0f, 0.0f, 0.0f);
+
+			for (int f = 0; f < m_FrameCount; f++)
+			{
+				glm::vec3 t, scale;
+				glm::quat r;
+				sample(c, f * m_TickStep, cursor, t, r, scale);
+
+				if (f > 0 && glm::dot(previous, r) < 0.0f)
+					r = -r;
+				previous = r;
+
+				size_t i = (size_t)f * m_ChannelCount + c;
+				m_Streams[TX][i] = t.x; m_Streams[TY][i] = t.y; m_Streams[TZ][i] = t.z;
+				m_Streams[RX][i] = r.x; m_Streams[RY][i] = r.y; m_Streams[RZ][i] = r.z; m_Streams[RW][i] = r.w;
+				m_Streams[SX][i] = scale.x; m_Streams[SY][i] = scale.y; m_Streams[SZ][i] = scale.z;
+			}
+		}
+	}
+
+	// Samples every channel at animationTime (in ticks); the two frames are blended
+	// across channels with the pose kernels
+	void SampleAll(float animationTime, LocalPose& outPose) const
+	{
+		int f0;
+		float alpha;
+		FrameAt(animationTime, f0, alpha);
+
+		static_assert((int)STREAM_COUNT == (int)LocalPose::STREAM_COUNT, "stream layouts must match");
+		const float* frame0[STREAM_COUNT];
+		const float* frame1[STREAM_COUNT];
+		float* out[STREAM_COUNT];
+		outPose.Resize(m_ChannelCount);
+		for (int s = 0; s < STREAM_COUNT; s++)
+		{
+			frame0[s] = m_Streams[s].data() + (size_t)f0 * m_ChannelCount;
+			frame1[s] = frame0[s] + m_ChannelCount;
+			out[s] = outPose.GetStream(s);
+		}
+		BlendPoses(frame0, frame1, alpha, m_ChannelCount, out);
+	}
+
+	void Sample(int channel, float animationTime, glm::vec3& outT, glm::quat& outR, glm::vec3& outS) const
+	{
+		int f0;
+		float alpha;
+		FrameAt(animationTime, f0, alpha);
+
+		size_t i0 = (size_t)f0 * m_ChannelCount + channel;
+		SampleChannel(i0, i0 + m_ChannelCount, alpha, outT, outR, outS);
+	}
+
+	inline bool IsBuilt() const { return m_FrameCount > 0; }
+	inline int GetFrameCount() const { return m_FrameCount; }
+	inline int GetChannelCount() const { return m_ChannelCount; }
+
+	size_t GetMemoryUsage() const
+	{
+		return (size_t)m_FrameCount * m_ChannelCount * STREAM_COUNT * sizeof(float);
+	}
+
+	// Identifies the sampled data, so tables baked from it can tell when it changed
+	uint64_t GetContentHash() const
+	{
+		uint64_t hash = HashBytes((const unsigned char*)&m_TickStep, sizeof(m_TickStep));
+		for (int s = 0; s < STREAM_COUNT; s++)
+			hash = HashBytes((const unsigned char*)m_Streams[s].data(), m_Streams[s].size() * sizeof(float), hash);
+		return hash;
+	}
+
+	// Memory of the same channels in Bone's key vectors, for comparison
+	static size_t GetKeyframeMemoryUsage(const std::vector<Bone>& bones)
+	{
+		size_t bytes = 0;
+		for (const Bone& bone : bones)
+		{
+			bytes += bone.m_Positions.size() * sizeof(KeyPosition);
+			bytes += bone.m_Rotations.size() * sizeof(KeyRotation);
+			bytes += bone.m_Scales.size() * sizeof(KeyScale);
+		}
+		return bytes;
+	}
+
+private:
+	inline void FrameAt(float animationTime, int& f0, float& alpha) const
+	{
+		float frame = glm::clamp(animationTime * m_InvTickStep, 0.0f, (float)(m_FrameCount - 1));
+		f0 = std::min((int)frame, m_FrameCount - 2);
+		alpha = frame - f0;
+	}
+
+	inline void SampleChannel(size_t i0, size_t i1, float alpha,
+		glm::vec3& outT, glm::quat& outR, glm::vec3& outS) const
+	{
+		const std::vector<float>* s = m_Streams;
+		outT = glm::vec3(Lerp(s[TX], i0, i1, alpha), Lerp(s[TY], i0, i1, alpha), Lerp(s[TZ], i0, i1, alpha));
+		outS = glm::vec3(Lerp(s[SX], i0, i1, alpha), Lerp(s[SY], i0, i1, alpha), Lerp(s[SZ], i0, i1, alpha));
+		outR = glm::normalize(glm::quat(Lerp(s[RW], i0, i1, alpha), Lerp(s[RX], i0, i1, alpha),
+			Lerp(s[RY], i0, i1, alpha), Lerp(s[RZ], i0, i1, alpha)));
+	}
+
+	static inline float Lerp(const std::vector<float>& stream, size_t i0, size_t i1, float alpha)
+	{
+		return stream[i0] + (stream[i1] - stream[i0]) * alpha;
+	}
+
+	std::vector<float> m_Streams[STREAM_COUNT];
+	int m_ChannelCount = 0;
+	int m_FrameCount = 0;
+	float m_TickStep = 0.0f;
+	float m_InvTickStep = 0.0f;
+};
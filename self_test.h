@@ -0,0 +1,494 @@
+#pragma once
+
+/* Checks of the fast paths against the plain versions they replace, run with
+   --self-test. They need no window or assets: every case is generated from a
+   fixed seed, so a failure reproduces exactly. Each check prints one summary
+   line and returns false on any mismatch. */
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstdlib>
+#include <new>
+#include <map>
+#include <string>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/norm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <learnopengl/collision_utils.h>
+#include <learnopengl/collision_mesh.h>
+#include <learnopengl/collision_simd.h>
+#include <learnopengl/pose_simd.h>
+#include <learnopengl/compressed_clip.h>
+#include <learnopengl/animator.h>
+
+// Drops spheres through thin triangles at high speed and compares the swept time
+// of impact with the first overlap found by stepping the same move in tiny steps
+inline bool CheckSweptSphere()
+{
+    const int CASES = 4000;
+    const int STEPS = 4000;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    auto distanceAt = [](const glm::vec3& p, const glm::vec3& a, const glm::vec3& ab, const glm::vec3& ac)
+        {
+            return glm::length(p - ClosestPtPointTriangleEdges(p, a, ab, ac));
+        };
+
+    int hits = 0, failures = 0;
+
+    // half through the plane beside the triangle and sinking away from it: the plane
+    // touch lies in the past, and must not be reported as a negative time of impact
+    {
+        float toi = 0.0f;
+        glm::vec3 contact;
+        if (SweptSphereTriangle(glm::vec3(2.0f, 0.2f, 0.3f), 0.5f, glm::vec3(0.5f, -0.1f, 0.0f),
+            glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), toi, contact))
+        {
+            std::cout << "  swept sphere beside the triangle hit at " << toi << std::endl;
+            failures++;
+        }
+    }
+
+    for (int c = 0; c < CASES; c++)
+    {
+        // a near-horizontal platform, and a sphere above, beside or partly through its
+        // plane moving down fast enough to cross it in one step
+        glm::vec3 a(unit(rng) * 2.0f, unit(rng) * 0.2f, unit(rng) * 2.0f);
+        glm::vec3 ab(unit(rng) * 2.0f, unit(rng) * 0.2f, unit(rng) * 2.0f);
+        glm::vec3 ac(unit(rng) * 2.0f, unit(rng) * 0.2f, unit(rng) * 2.0f);
+        float radius = 0.45f + 0.25f * unit(rng);
+        glm::vec3 center(unit(rng) * 3.0f, 1.25f + 1.75f * unit(rng), unit(rng) * 3.0f);
+        glm::vec3 move(unit(rng), -(22.0f + 18.0f * unit(rng)), unit(rng));
+
+        // the swept query treats a starting overlap specially; only first contacts count
+        if (distanceAt(center, a, ab, ac) <= radius)
+            continue;
+
+        int first = -1;
+        for (int k = 1; k <= STEPS && first < 0; k++)
+            if (distanceAt(center + move * ((float)k / STEPS), a, ab, ac) <= radius)
+                first = k;
+
+        float toi = 0.0f;
+        glm::vec3 contact;
+        bool swept = SweptSphereTriangle(center, radius, move, a, ab, ac, toi, contact);
+        float touch = swept ? distanceAt(center + move * toi, a, ab, ac) : 0.0f;
+
+        bool ok;
+        if (!swept)
+            ok = first < 0;
+        else if (toi < 0.0f || toi > 1.0f || fabs(touch - radius) > 2e-3f)
+            ok = false;
+        else if (first < 0)
+            ok = true;      // a graze between two steps
+        else
+            ok = toi >= (first - 1.0f) / STEPS - 1e-4f && toi <= (float)first / STEPS + 1e-4f;
+
+        hits += swept ? 1 : 0;
+        if (!ok && failures++ < 5)
+        {
+            std::cout << "  swept sphere case " << c << ": " << (swept ? "hit" : "miss") << " at " << toi
+                << ", first overlap at step " << first << " of " << STEPS << std::endl;
+        }
+    }
+
+    std::cout << "Swept sphere vs discrete steps: " << CASES << " drops, " << hits << " hits, "
+        << failures << " mismatches" << std::endl;
+    return failures == 0;
+}
+
+// The scalar reference: ClosestPtPointTriangle on the triangle's vertices
+inline bool ScalarSphereTriangle(const glm::vec3& center, float radius, const CollisionMesh& mesh,
+    size_t tri, glm::vec3& outP)
+{
+    glm::vec3 a = mesh.GetA(tri);
+    return TestSphereTriangle(center, radius, a, a + mesh.GetAB(tri), a + mesh.GetAC(tri), outP);
+}
+
+// True when the build fuses a * b + c into one rounding (GCC and Clang do with FMA
+// enabled and their default -ffp-contract). The packet kernels and the scalar test
+// may then fuse different multiply-adds, so their points can differ in the last bits.
+inline bool FusesMultiplyAdd()
+{
+    volatile float x = 1.0f + 1.0f / 4096.0f;   // x * x = 1 + 2^-11 + 2^-24
+    float a = x;
+    return a * a - (1.0f + 1.0f / 2048.0f) != 0.0f;
+}
+
+// Closest points of the packet kernels and the scalar test must be identical, or
+// within a few ulps of the test scene's coordinates (all within 4 of the origin)
+// when multiply-adds are fused
+inline bool SameClosestPoint(const glm::vec3& packet, const glm::vec3& scalar)
+{
+    static const float tolerance = FusesMultiplyAdd() ? 4.0f * 4.0f * FLT_EPSILON : 0.0f;
+    glm::vec3 difference = glm::abs(packet - scalar);
+    return std::max(difference.x, std::max(difference.y, difference.z)) <= tolerance;
+}
+
+// One packet kernel against the scalar test on every lane; hit bits must be identical
+template <typename S>
+inline int CompareSphereTrianglePacket(const glm::vec3& center, float radius, const CollisionMesh& mesh,
+    size_t first, const char* name)
+{
+    glm::vec3 packet[S::WIDTH];
+    unsigned int mask = TestSphereTrianglePacket<S>(center, radius, mesh, first, packet);
+
+    int failures = 0;
+    for (int i = 0; i < S::WIDTH; i++)
+    {
+        glm::vec3 scalar;
+        bool hit = ScalarSphereTriangle(center, radius, mesh, first + i, scalar);
+        if ((!SameClosestPoint(packet[i], scalar) || hit != (bool)((mask >> i) & 1u)) && failures++ < 5)
+        {
+            std::cout << "  " << name << " lane " << i << " of triangle " << first << ": "
+                << ((mask >> i) & 1u) << " vs scalar " << hit << std::endl;
+        }
+    }
+    return failures;
+}
+
+// The SSE and AVX kernels and the batch entry point against ClosestPtPointTriangle, on
+// random triangles of every shape around random spheres. Vertices and centres lie on
+// a 1/8 grid, so the mesh's stored edges are exactly b - a and c - a and both forms
+// of the test see the same numbers.
+inline bool CheckSphereTrianglesSimd()
+{
+    const int TRIANGLES = 1024;
+    const int QUERIES = 4000;
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> grid(-16, 16);
+    auto point = [&](float scale) { return glm::vec3(grid(rng), grid(rng), grid(rng)) * (scale / 8.0f); };
+
+    CollisionMesh mesh;
+    mesh.Resize(TRIANGLES);
+    for (int t = 0; t < TRIANGLES; t++)
+    {
+        // some slivers and specks as well; degenerate ones have no closest point to compare
+        glm::vec3 a, b, c;
+        do
+        {
+            a = point(1.0f);
+            b = a + point(t % 8 == 0 ? 0.0625f : 1.0f);
+            c = a + point(1.0f);
+        } while (glm::length2(glm::cross(b - a, c - a)) == 0.0f);
+        mesh.SetTriangle(t, a, b, c);
+    }
+
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    int failures = 0, hits = 0;
+    for (int q = 0; q < QUERIES; q++)
+    {
+        glm::vec3 center = point(1.5f);
+        float radius = 0.05f + unit(rng);
+        size_t first = (size_t)(q * 7) % (TRIANGLES - 32);
+
+#if COLLISION_SIMD_WIDTH >= 4
+        failures += CompareSphereTrianglePacket<SimdSSE>(center, radius, mesh, first, "SSE");
+#endif
+#if COLLISION_SIMD_WIDTH >= 8
+        failures += CompareSphereTrianglePacket<SimdAVX>(center, radius, mesh, first, "AVX");
+#endif
+
+        // every count up to a full mask, so each kernel width and the scalar tail run
+        glm::vec3 closest[32];
+        int count = 1 + q % 32;
+        unsigned int mask = TestSphereTriangles(center, radius, mesh, first, count, closest);
+        for (int i = 0; i < count; i++)
+        {
+            glm::vec3 scalar;
+            bool hit = ScalarSphereTriangle(center, radius, mesh, first + i, scalar);
+            hits += hit ? 1 : 0;
+            if ((hit != (bool)((mask >> i) & 1u) || !SameClosestPoint(closest[i], scalar)) && failures++ < 5)
+                std::cout << "  batch of " << count << " at " << first << ", triangle " << i << " differs" << std::endl;
+        }
+    }
+
+    std::cout << "Sphere-triangle SIMD (width " << COLLISION_SIMD_WIDTH << ") vs ClosestPtPointTriangle: " << QUERIES
+        << " queries, " << hits << " hits, " << failures << " mismatches"
+        << (FusesMultiplyAdd() ? " (fused multiply-adds, points to a few ulps)" : " (points exact)") << std::endl;
+    return failures == 0;
+}
+
+// Largest element difference between a 3x4 and the top three rows of a mat4
+inline float AffineDifference(const Affine3x4& a, const glm::mat4& m)
+{
+    float worst = 0.0f;
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 4; c++)
+            worst = std::max(worst, (float)fabs(a.m[r][c] - m[c][r]));
+    return worst;
+}
+
+// ComposeAffine on poses of every length, so the AVX, SSE and scalar paths all run,
+// against glm::translate * glm::toMat4 * glm::scale as Bone::Update built it; then
+// chains of MultiplyAffine against the mat4 products CalculateBoneTransform did
+inline bool CheckAffineCompose()
+{
+    const int POSES = 200;
+    const float TOLERANCE = 1e-5f;      // relative to the largest element
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    LocalPose pose;
+    std::vector<Affine3x4> composed;
+    std::vector<glm::mat4> reference;
+    float worst = 0.0f;
+    int failures = 0;
+
+    for (int p = 0; p < POSES; p++)
+    {
+        int count = 1 + p % 67;
+        pose.Resize(count);
+        composed.resize(count);
+        reference.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            glm::vec3 t(unit(rng) * 10.0f, unit(rng) * 10.0f, unit(rng) * 10.0f);
+            glm::quat q = glm::normalize(glm::quat(unit(rng), unit(rng), unit(rng), unit(rng)));
+            glm::vec3 s(1.0f + 0.5f * unit(rng), 1.0f + 0.5f * unit(rng), 1.0f + 0.5f * unit(rng));
+            pose.Set(i, t, q, s);
+            reference[i] = glm::translate(glm::mat4(1.0f), t) * glm::toMat4(q) * glm::scale(glm::mat4(1.0f), s);
+        }
+        ComposeAffine(pose, composed.data());
+        for (int i = 0; i < count; i++)
+        {
+            float error = AffineDifference(composed[i], reference[i]) / 10.0f;
+            worst = std::max(worst, error);
+            if (error > TOLERANCE && failures++ < 5)
+                std::cout << "  compose of bone " << i << " of " << count << " off by " << error << std::endl;
+        }
+
+        // each bone parented to the one before, the deepest chain a pose of this size allows
+        Affine3x4 global = composed[0];
+        glm::mat4 globalReference = reference[0];
+        for (int i = 1; i < count; i++)
+        {
+            MultiplyAffine(global, composed[i], global);
+            globalReference = globalReference * reference[i];
+            float scale = 1.0f;
+            for (int c = 0; c < 4; c++)
+                for (int r = 0; r < 3; r++)
+                    scale = std::max(scale, (float)fabs(globalReference[c][r]));
+            float error = AffineDifference(global, globalReference) / scale;
+            worst = std::max(worst, error);
+            if (error > TOLERANCE * i && failures++ < 5)
+                std::cout << "  hierarchy depth " << i << " off by " << error << std::endl;
+        }
+    }
+
+    std::cout << "Affine compose (width " << SIMD_WIDTH << ") vs glm mat4: " << POSES << " poses, max relative error "
+        << worst << ", " << failures << " mismatches" << std::endl;
+    return failures == 0;
+}
+
+// Synthetic channels for CheckCompressedClip: smooth, noisy and constant, with keys
+// every tick or, with offGrid, at uneven times. outSpeed gets the fastest change per
+// tick of each curve (position, rotation in radians, scale) between two keys.
+inline void MakeTestChannels(bool offGrid, unsigned int seed, std::vector<Bone>& outBones, float& outDuration,
+    glm::vec3& outSpeed)
+{
+    const int CHANNELS = 48;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    outBones.clear();
+    outDuration = 0.0f;
+    outSpeed = glm::vec3(0.0f);
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        int keys = 2 + c * 5;
+        float noise = c % 4 == 3 ? 0.05f : 0.0f;
+        float frequency = 0.05f + 0.1f * (unit(rng) + 1.0f);
+        glm::vec3 amplitude(unit(rng) * 5.0f, unit(rng) * 5.0f, unit(rng) * 5.0f);
+        bool constant = c % 6 == 0;
+
+        std::vector<KeyPosition> positions;
+        std::vector<KeyRotation> rotations;
+        std::vector<KeyScale> scales;
+        float time = 0.0f;
+        for (int k = 0; k < keys; k++)
+        {
+            float phase = constant ? 0.0f : time * frequency;
+            glm::vec3 jitter(unit(rng) * noise, unit(rng) * noise, unit(rng) * noise);
+            positions.push_back({ amplitude * (float)sin(phase) + jitter, time });
+            glm::quat rotation = glm::normalize(glm::quat((float)cos(phase), (float)sin(phase) * 0.6f,
+                (float)sin(phase * 0.7f) * 0.3f + jitter.x, 0.2f + jitter.y));
+            rotations.push_back({ rotation, time });
+            scales.push_back({ glm::vec3(1.0f + 0.2f * (float)sin(phase * 1.3f)) + jitter, time });
+
+            if (k > 0)
+            {
+                float dt = time - positions[k - 1].timeStamp;
+                outSpeed.x = std::max(outSpeed.x, glm::length(positions[k].position - positions[k - 1].position) / dt);
+                outSpeed.y = std::max(outSpeed.y, CompressedClip::RotationError(rotations[k].orientation, rotations[k - 1].orientation) / dt);
+                outSpeed.z = std::max(outSpeed.z, glm::length(scales[k].scale - scales[k - 1].scale) / dt);
+            }
+            time += offGrid ? 0.7f + 0.3f * unit(rng) : 1.0f;
+        }
+        outDuration = std::max(outDuration, positions.back().timeStamp);
+        outBones.emplace_back("channel" + std::to_string(c), c, std::move(positions), std::move(rotations), std::move(scales));
+    }
+}
+
+// Compresses synthetic clips and measures the decoded curves against the source keys
+// at every key, every midpoint and densely in between. Keys on the tick grid must
+// stay inside the build tolerances; keys off it may add the speed of the curve times
+// half the clip's time step.
+inline bool CheckCompressedClip()
+{
+    const float POSITION_TOLERANCE = 0.001f, ROTATION_TOLERANCE = 0.001f, SCALE_TOLERANCE = 0.001f;
+    const int SAMPLES = 4096;
+    bool ok = true;
+
+    for (int offGrid = 0; offGrid < 2; offGrid++)
+    {
+        std::vector<Bone> bones;
+        float duration;
+        glm::vec3 speed;
+        MakeTestChannels(offGrid != 0, 4, bones, duration, speed);
+
+        CompressedClip clip;
+        clip.Build(bones, duration, POSITION_TOLERANCE, ROTATION_TOLERANCE, SCALE_TOLERANCE);
+        float positionError, rotationError, scaleError;
+        clip.MeasureError(bones, positionError, rotationError, scaleError);
+
+        // between the sample points MeasureError uses
+        for (size_t c = 0; c < bones.size(); c++)
+        {
+            BoneCursor sourceCursor, cursor;
+            for (int i = 0; i <= SAMPLES; i++)
+            {
+                float time = duration * i / SAMPLES;
+                glm::vec3 sourceT, sourceS, T, S;
+                glm::quat sourceR, R;
+                bones[c].Sample(time, sourceCursor, sourceT, sourceR, sourceS);
+                clip.Sample((int)c, time, cursor, T, R, S);
+                positionError = std::max(positionError, glm::length(sourceT - T));
+                rotationError = std::max(rotationError, CompressedClip::RotationError(sourceR, R));
+                scaleError = std::max(scaleError, glm::length(sourceS - S));
+            }
+        }
+
+        // the same 1% slack the load-time report allows for float rounding
+        glm::vec3 shift = offGrid ? speed * (0.5f * clip.GetTimeStep()) : glm::vec3(0.0f);
+        bool within = positionError <= POSITION_TOLERANCE * 1.01f + shift.x
+            && rotationError <= ROTATION_TOLERANCE * 1.01f + shift.y
+            && scaleError <= SCALE_TOLERANCE * 1.01f + shift.z;
+        ok = ok && within;
+
+        std::cout << "Compressed clip vs source keys (" << (offGrid ? "off" : "on") << " the tick grid): "
+            << CompressedClip::GetSourceKeyCount(bones) << " -> " << clip.GetKeyCount() << " keys, max error "
+            << positionError << " pos, " << rotationError << " rad, " << scaleError << " scale"
+            << (within ? "" : " EXCEEDS TOLERANCE") << std::endl;
+    }
+    return ok;
+}
+
+// Allocations made on this thread while CheckPoseAllocations points this at its
+// counter; null everywhere else, so the operator new below costs one test
+static thread_local size_t* gCountedAllocations = nullptr;
+
+// Replaces the global allocator of the one program that includes this header
+void* operator new(size_t size)
+{
+    if (gCountedAllocations)
+        ++*gCountedAllocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+// Node i of a binary tree over the MakeTestChannels channels, each one a bone
+inline AssimpNodeData MakeTestHierarchy(int index, int count, std::map<std::string, BoneInfo>& boneInfoMap)
+{
+    AssimpNodeData node;
+    node.name = "channel" + std::to_string(index);
+    node.transformation = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    for (int child = index * 2 + 1; child <= index * 2 + 2 && child < count; child++)
+        node.children.push_back(MakeTestHierarchy(child, count, boneInfoMap));
+    node.childrenCount = (int)node.children.size();
+    boneInfoMap[node.name] = { index, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f)) };
+    return node;
+}
+
+// Warms up an Animator on each clip representation, with and without LOD, then
+// runs steady-state frames of update, swap and matrix reads and fails on any
+// heap allocation among them
+inline bool CheckPoseAllocations()
+{
+    const int WARMUP_FRAMES = 600;
+    const int FRAMES = 1200;
+    const float DT = 1.0f / 60.0f;
+    const char* names[] = { "keys", "resampled", "compressed", "baked" };
+
+    std::vector<Bone> bones;
+    float duration;
+    glm::vec3 speed;
+    MakeTestChannels(true, 11, bones, duration, speed);
+    std::map<std::string, BoneInfo> boneInfoMap;
+    AssimpNodeData root = MakeTestHierarchy(0, (int)bones.size(), boneInfoMap);
+
+    Animation clips[4];
+    for (Animation& clip : clips)
+        clip.Assign(duration, 60, root, bones, boneInfoMap);
+    clips[1].Resample(30.0f);
+    clips[2].Compress(0.001f, 0.001f, 0.001f);
+    BakedPoseTable baked;
+    baked.Bake(clips[3], 30.0f);
+    clips[3].SetBakedPoses(&baked);
+
+    bool ok = true;
+    for (int c = 0; c < 4; c++)
+    {
+        for (int lod = 0; lod < 2; lod++)
+        {
+            Animator animator(&clips[c]);
+            if (lod)
+                animator.SetLODBands({ { 1000.0f, 12.0f, 1 } });
+
+            size_t allocations = 0;
+            float checksum = 0.0f;
+            for (int frame = 0; frame < WARMUP_FRAMES + FRAMES; frame++)
+            {
+                gCountedAllocations = frame < WARMUP_FRAMES ? nullptr : &allocations;
+                animator.UpdateAnimation(DT);
+                animator.SwapPoseBuffers();
+                BoneMatrixView matrices = animator.GetBoneMatrices();
+                checksum += matrices[frame % matrices.size()][3][1];
+            }
+            gCountedAllocations = nullptr;
+
+            std::cout << "Pose allocations (" << names[c] << (lod ? ", LOD" : "") << "): " << allocations
+                << " in " << FRAMES << " frames" << (std::isfinite(checksum) ? "" : ", non-finite pose") << std::endl;
+            ok = ok && allocations == 0 && std::isfinite(checksum);
+        }
+    }
+    return ok;
+}
+
+inline bool RunSelfTests()
+{
+    bool ok = CheckSweptSphere();
+    ok = CheckSphereTrianglesSimd() && ok;
+    ok = CheckAffineCompose() && ok;
+    ok = CheckCompressedClip() && ok;
+    ok = CheckPoseAllocations() && ok;
+    std::cout << (ok ? "Self test passed" : "Self test FAILED") << std::endl;
+    return ok;
+}
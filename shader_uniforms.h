@@ -0,0 +1,90 @@
+#pragma once
+
+/* Typed uniform handles. The location is looked up once after linking, and each
+   handle remembers the last value it sent, so setting an unchanged value makes no
+   GL call. Uniform values belong to the program object, so this stays correct
+   across glUseProgram switches as long as only the handle writes that uniform.
+   UniformStats counts the GL calls made through the handles; with the cache
+   disabled they behave like Shader::set*, a lookup and a send on every call. */
+
+#include <string>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader_m.h>
+
+struct UniformStats
+{
+    // GL calls issued through handles since the last TakeCalls
+    static int& Calls()
+    {
+        static int calls = 0;
+        return calls;
+    }
+
+    static int TakeCalls()
+    {
+        int calls = Calls();
+        Calls() = 0;
+        return calls;
+    }
+
+    // false reproduces per-call lookups and unconditional sends, for comparison
+    static bool& CacheEnabled()
+    {
+        static bool enabled = true;
+        return enabled;
+    }
+};
+
+inline void UploadUniform(GLint location, float value) { glUniform1f(location, value); }
+inline void UploadUniform(GLint location, int value) { glUniform1i(location, value); }
+inline void UploadUniform(GLint location, bool value) { glUniform1i(location, (int)value); }
+inline void UploadUniform(GLint location, const glm::vec3& value) { glUniform3fv(location, 1, &value[0]); }
+inline void UploadUniform(GLint location, const glm::mat4& value) { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+
+template <typename T>
+class UniformHandle
+{
+public:
+    // Resolves the location; once after the program is linked
+    void Bind(const Shader& shader, const std::string& name)
+    {
+        m_Program = shader.ID;
+        m_Name = name;
+        m_Location = glGetUniformLocation(m_Program, m_Name.c_str());
+        m_HasValue = false;
+        UniformStats::Calls()++;
+    }
+
+    // Sends value unless it is the one sent last; the program must be in use
+    void Set(const T& value)
+    {
+        if (!UniformStats::CacheEnabled())
+        {
+            m_Location = glGetUniformLocation(m_Program, m_Name.c_str());
+            UploadUniform(m_Location, value);
+            m_HasValue = false;
+            UniformStats::Calls() += 2;
+            return;
+        }
+
+        // inactive uniforms (optimised out, or not in this program) cost nothing
+        if (m_Location < 0 || (m_HasValue && m_Value == value))
+            return;
+        UploadUniform(m_Location, value);
+        m_Value = value;
+        m_HasValue = true;
+        UniformStats::Calls()++;
+    }
+
+    // The next Set sends its value, e.g. after something else wrote the uniform
+    inline void Invalidate() { m_HasValue = false; }
+    inline bool IsActive() const { return m_Location >= 0; }
+
+private:
+    unsigned int m_Program = 0;
+    std::string m_Name;
+    GLint m_Location = -1;
+    T m_Value = T();
+    bool m_HasValue = false;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+/* Compile-time shader permutations. A variant is a shader source with #define lines
+   inserted right after its #version directive. The expanded source is compiled and
+   linked in memory, so nothing is written next to the assets and a variant that
+   fails to build is reported with its defines instead of quietly running as the
+   base shader. */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <glad/glad.h>
+#include <learnopengl/shader_m.h>
+
+// Source of path with "#define NAME" for each entry of defines after the #version line
+inline bool ExpandShaderVariant(const std::string& path, const std::vector<std::string>& defines,
+    std::string& outSource)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "Failed to read shader " << path << std::endl;
+        return false;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    outSource = stream.str();
+
+    std::string block;
+    for (const std::string& define : defines)
+        block += "#define " + define + "\n";
+
+    // #version has to stay the first directive in the source
+    size_t insertAt = 0;
+    size_t version = outSource.find("#version");
+    if (version != std::string::npos)
+    {
+        size_t lineEnd = outSource.find('\n', version);
+        if (lineEnd == std::string::npos)
+        {
+            outSource += '\n';
+            lineEnd = outSource.size() - 1;
+        }
+        insertAt = lineEnd + 1;
+    }
+    outSource.insert(insertAt, block);
+    return true;
+}
+
+// "anim_model.vs [SKINNED PACKED_VERTEX]", so driver errors name the variant
+inline std::string DescribeShaderVariant(const std::string& path, const std::vector<std::string>& defines)
+{
+    std::string name = path + " [";
+    for (size_t i = 0; i < defines.size(); i++)
+        name += (i > 0 ? " " : "") + defines[i];
+    return name + "]";
+}
+
+// Compiles source as a shader of the given type; 0 on failure
+inline unsigned int CompileShaderSource(GLenum type, const std::string& source, const std::string& name)
+{
+    unsigned int shader = glCreateShader(type);
+    const char* text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cout << "Failed to compile shader " << name << ":\n" << log << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Builds vertexPath with defines and fragmentPath (with the same defines) into a new
+// program; 0 on failure, for the caller to treat as fatal
+inline unsigned int LinkShaderVariant(const std::string& vertexPath, const std::string& fragmentPath,
+    const std::vector<std::string>& defines)
+{
+    std::string vertexSource, fragmentSource;
+    if (!ExpandShaderVariant(vertexPath, defines, vertexSource) ||
+        !ExpandShaderVariant(fragmentPath, defines, fragmentSource))
+        return 0;
+
+    std::string vertexName = DescribeShaderVariant(vertexPath, defines);
+    std::string fragmentName = DescribeShaderVariant(fragmentPath, defines);
+    unsigned int vertex = CompileShaderSource(GL_VERTEX_SHADER, vertexSource, vertexName);
+    unsigned int fragment = CompileShaderSource(GL_FRAGMENT_SHADER, fragmentSource, fragmentName);
+    if (vertex == 0 || fragment == 0)
+    {
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        std::cout << "Failed to link " << vertexName << " with " << fragmentName << ":\n" << log << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// A Shader running the variant's own program, with ID 0 when it failed to build.
+// Shader only has a constructor that compiles its files, so the variant copies an
+// already built Shader and replaces the program; base keeps its own.
+inline Shader MakeShaderVariant(const Shader& base, const std::string& vertexPath,
+    const std::string& fragmentPath, const std::vector<std::string>& defines)
+{
+    Shader variant = base;
+    variant.ID = LinkShaderVariant(vertexPath, fragmentPath, defines);
+    return variant;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+/* Thin wrappers over SSE and AVX registers so packet kernels can be written once
+   as templates and instantiated for each width. SIMD_WIDTH is the widest set the
+   build targets: 8 with AVX2, 4 with SSE2, 1 without either. */
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+#else
+#define SIMD_WIDTH 1
+#endif
+
+#if SIMD_WIDTH >= 4
+struct SimdSSE
+{
+    typedef __m128 Reg;
+    static const int WIDTH = 4;
+
+    static inline Reg Load(const float* p) { return _mm_loadu_ps(p); }
+    static inline void Store(float* p, Reg a) { _mm_storeu_ps(p, a); }
+    static inline Reg Set1(float f) { return _mm_set1_ps(f); }
+    static inline Reg Add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    static inline Reg Sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+    static inline Reg Mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+    static inline Reg Div(Reg a, Reg b) { return _mm_div_ps(a, b); }
+    static inline Reg Sqrt(Reg a) { return _mm_sqrt_ps(a); }
+    static inline Reg Lt(Reg a, Reg b) { return _mm_cmplt_ps(a, b); }
+    static inline Reg Le(Reg a, Reg b) { return _mm_cmple_ps(a, b); }
+    static inline Reg Ge(Reg a, Reg b) { return _mm_cmpge_ps(a, b); }
+    static inline Reg And(Reg a, Reg b) { return _mm_and_ps(a, b); }
+    static inline Reg Select(Reg mask, Reg a, Reg b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    static inline int MoveMask(Reg a) { return _mm_movemask_ps(a); }
+};
+#endif
+
+#if SIMD_WIDTH >= 8
+struct SimdAVX
+{
+    typedef __m256 Reg;
+    static const int WIDTH = 8;
+
+    static inline Reg Load(const float* p) { return _mm256_loadu_ps(p); }
+    static inline void Store(float* p, Reg a) { _mm256_storeu_ps(p, a); }
+    static inline Reg Set1(float f) { return _mm256_set1_ps(f); }
+    static inline Reg Add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+    static inline Reg Sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+    static inline Reg Mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+    static inline Reg Div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+    static inline Reg Sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+    static inline Reg Lt(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static inline Reg Le(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static inline Reg Ge(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static inline Reg And(Reg a, Reg b) { return _mm256_and_ps(a, b); }
+    static inline Reg Select(Reg mask, Reg a, Reg b) { return _mm256_blendv_ps(b, a, mask); }
+    static inline int MoveMask(Reg a) { return _mm256_movemask_ps(a); }
+};
+#endif
@@ -10,11 +10,25 @@
 #include <learnopengl/camera.h>
 #include <learnopengl/animator.h>
 #include <learnopengl/model_animation.h>
-#include <learnopengl/collision_utils.h>
+#include <learnopengl/map_collision.h>
+#include <learnopengl/collision_broadphase.h>
+#include <learnopengl/collision_grid.h>
+#include <learnopengl/collision_cache.h>
+
+#include <learnopengl/crowd_animator.h>
+#include <learnopengl/animation_cache.h>
+#include <learnopengl/asset_loader.h>
+#include <learnopengl/bone_palette.h>
+#include <learnopengl/shader_uniforms.h>
+#include <learnopengl/shader_variant.h>
+#include <learnopengl/packed_mesh.h>
+#include <learnopengl/self_test.h>
+#include <learnopengl/benchmarks.h>
 
 
 
 #include <iostream>
+#include <memory>
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -23,6 +37,67 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
 void CreatingSphere(std::vector<float>& vertex, std::vector<unsigned int>& indices);
 
+
+struct DecodedImage
+{
+	unsigned char* data = nullptr;
+	int width = 0, height = 0, nrChannels = 0;
+};
+void UploadTexture(unsigned int texture, DecodedImage& image);
+
+// uniforms set every frame, resolved once after the shaders are linked
+struct ModelShaderUniforms
+{
+	UniformHandle<glm::mat4> projection, view, model;
+	UniformHandle<glm::vec3> sunDirection, sunColor, viewPos;
+	UniformHandle<float> sunIntensity, shininess;
+	UniformHandle<bool> useTexture;
+	UniformHandle<int> texture1;
+
+	void Bind(const Shader& shader)
+	{
+		projection.Bind(shader, "projection");
+		view.Bind(shader, "view");
+		model.Bind(shader, "model");
+		sunDirection.Bind(shader, "sunDirection");
+		sunColor.Bind(shader, "sunColor");
+		viewPos.Bind(shader, "viewPos");
+		sunIntensity.Bind(shader, "sunIntensity");
+		shininess.Bind(shader, "shininess");
+		useTexture.Bind(shader, "useTexture");
+		texture1.Bind(shader, "texture1");
+	}
+
+	// camera and light for the frame; the handles skip whatever did not change
+	void SetFrame(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, const glm::vec3& cameraPosition)
+	{
+		projection.Set(projectionMatrix);
+		view.Set(viewMatrix);
+		sunDirection.Set(glm::normalize(glm::vec3(-0.3f, -1.0f, -0.2f)));
+		sunColor.Set(glm::vec3(1.0f, 1.0f, 0.95f)); // slightly warm
+		sunIntensity.Set(1.0f);   // 5 is very bright
+		shininess.Set(64.0f);
+		viewPos.Set(cameraPosition);
+	}
+};
+
+struct SkyShaderUniforms
+{
+	UniformHandle<glm::mat4> projection, view, model;
+	UniformHandle<int> skyTex;
+
+	void Bind(const Shader& shader)
+	{
+		projection.Bind(shader, "uProjection");
+		view.Bind(shader, "uView");
+		model.Bind(shader, "uModel");
+		skyTex.Bind(shader, "uSkyTex");
+	}
+};
+
+void BenchmarkShaderVariants(Model& map, const PackedModel* packedMap, Shader& skinnedShader,
+	ModelShaderUniforms& skinnedUniforms, Shader& staticShader, ModelShaderUniforms& staticUniforms);
+
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
@@ -51,6 +126,14 @@ float jumpVelocity = 0.0f;
 float gravity = -9.8f;
 float jumpStrength = 7.5f;
 float groundHeight = 0.7f;
+float walkSpeed = 4.0f;
+float wallRadius = 0.5f;
+
+bool printCollisionStats = false;
+bool useFloorRaycast = false;
+bool useGridBroadphase = false; // XZ spatial hash instead of the BVH, suits wide flat levels
+float gridCellSize = 2.0f;
+float sweepSkin = 0.001f;
 
 bool punching = false;
 float punchingDuration = 0;
@@ -66,79 +149,48 @@ bool isPunchLoop = true;
 
 float jumpAnimSpeed = 0.95f;
 
-bool jumpKeyPressed = false;
-bool punchKeyPressed = false;
-bool changeCamKeyPressed = false;
+bool resampleAnimations = false; // bake clips onto a uniform grid at load
+float resampleRate = 60.0f;      // samples per second
 
+bool compressAnimations = false;          // drop and quantise keys at load
+float compressPositionTolerance = 0.001f; // bone-space units
+float compressRotationTolerance = 0.001f; // radians
+float compressScaleTolerance = 0.001f;
 
-bool CheckMapCollision(const glm::vec3& pos, float radius, const Model& mapModel)
-{
-	for (const auto& mesh : mapModel.meshes)
-	{
-		const auto& verts = mesh.vertices;
-		const auto& idx = mesh.indices;
+int crowdSize = 0;            // extra instances animated on a thread pool each frame, 0 = off
 
-		for (size_t i = 0; i < idx.size(); i += 3)
-		{
-			glm::vec3 a = verts[idx[i]].Position;
-			glm::vec3 b = verts[idx[i + 1]].Position;
-			glm::vec3 c = verts[idx[i + 2]].Position;
+bool bakeAnimationPoses = false;   // pre-sample final matrices of every clip, cached on disk
+float bakedPoseRate = 30.0f;       // frames per second
+bool interpolateBakedPoses = true;
 
-			glm::vec3 closest;
-			if (TestSphereTriangle(pos, radius, a, b, c, closest))
-			{
-				return true;
-			}
-		}
-	}
-
-	return false;
-}
+bool useAnimationLOD = false;      // lower update rate and bone culling with camera distance
+bool printAnimationStats = false;  // bones evaluated per frame
+bool uploadBonePalette = true;     // false sends each bone with its own glUniformMatrix4fv, as before the palette
+bool printBoneUploadTime = false;  // average CPU time of the bone upload, either way
 
-float ResolveVerticalCollision(glm::vec3& pos, float radius, const Model& mapModel, float currentVelocityY)
-{
-	float floorY = -9999.0f;
-	bool foundFloor = false;
-
-	for (const auto& mesh : mapModel.meshes)
-	{
-		const auto& verts = mesh.vertices;
-		const auto& idx = mesh.indices;
+bool cacheUniforms = true;          // false looks every uniform up and sends it each frame, as Shader::set* does
+bool printUniformCalls = false;     // uniform GL calls per frame
 
-		for (size_t i = 0; i < idx.size(); i += 3)
-		{
-			glm::vec3 a = verts[idx[i]].Position;
-			glm::vec3 b = verts[idx[i + 1]].Position;
-			glm::vec3 c = verts[idx[i + 2]].Position;
-
-			glm::vec3 closest;
+bool usePackedVertices = true;     // draw models from compact per-mesh vertex buffers
 
-			if (TestSphereTriangle(pos, radius, a, b, c, closest))
-			{
-				if (closest.y < pos.y)
-				{
-					if (closest.y > floorY)
-					{
-						floorY = closest.y;
-						foundFloor = true;
-					}
-				}
-			}
-		}
-	}
+bool useAnimationCache = true;     // load clips from binary caches next to the .dae files
+bool asyncAssetLoading = true;     // decode assets on worker threads at startup, false = one after another
 
-	if (foundFloor)
-	{
-		float newY = floorY + radius;
-		pos.y = newY;
+const char* clipPaths[] = {
+	"_rooster/objects/catman/CatBoi_Walk.dae",
+	"_rooster/objects/catman/CatBoi_Idle.dae",
+	"_rooster/objects/catman/CatBoi_Jump.dae",
+	"_rooster/objects/catman/CatBoi_Punch.dae",
+};
 
-		return 0.0f; // reset ความเร็ว Y
-	}
+bool jumpKeyPressed = false;
+bool punchKeyPressed = false;
+bool changeCamKeyPressed = false;
 
-	return currentVelocityY;
-}
 
-static Model* gMapModel;
+static CollisionMesh* gMapMesh;
+static CollisionGrid* gMapGrid;
+static ContactCache gContactCache;
 
 glm::vec3 spawnPoint(0.0f, 5.0f, 0.0f);
 float initialYVelocity = 0.0f;
@@ -151,11 +203,43 @@ void Respawn()
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
+	// --bake: write the animation caches and exit, without opening a window
+	if (argc > 1 && std::string(argv[1]) == "--bake")
+	{
+		bool baked = true;
+		for (const char* path : clipPaths)
+		{
+			SourceFile source(path);
+			bool ok = AnimationCache::Bake(source, std::string(path) + ".anim");
+			std::cout << (ok ? "Baked " : "Failed to bake ") << path << std::endl;
+			baked = baked && ok;
+		}
+		return baked ? 0 : 1;
+	}
+
+	// --self-test: check the fast paths against their reference versions and exit
+	if (argc > 1 && std::string(argv[1]) == "--self-test")
+		return RunSelfTests() ? 0 : 1;
+
+	// --benchmark [name ...]: time the fast paths against what they replaced and exit;
+	// the ones on the game's assets load them as usual, in a hidden window
+	BenchmarkSelection benchmarks;
+	BenchmarkSettings benchmarkSettings = { wallRadius, walkSpeed, groundHeight, gridCellSize, resampleRate };
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		if (!benchmarks.Select(argc - 2, argv + 2))
+			return 1;
+		RunSyntheticBenchmarks(benchmarks, benchmarkSettings);
+		if (!benchmarks.NeedsAssets())
+			return 0;
+	}
+
 	// glfw: initialize and configure
 	// ------------------------------
 	glfwInit();
+	double startupStart = glfwGetTime();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -163,6 +247,8 @@ int main()
 #ifdef __APPLE__
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+	if (benchmarks.IsActive())
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
 	// glfw window creation
 	// --------------------
@@ -198,7 +284,9 @@ int main()
 
 	// build and compile shaders
 	// -------------------------
-	Shader ourShader(
+	// static geometry skips all bone work; the character's skinned variant is built
+	// once the models are loaded and have settled its vertex layout
+	Shader staticShader(
 		"anim_model.vs",
 		"anim_model.fs"
 	);
@@ -208,18 +296,278 @@ int main()
 		"sky.fs"
 	);
 
-	// load models
-	// -----------
-	Model ourModel("_rooster/objects/catman/CatBoi_Walk.dae");
-	Model mapModel("_rooster/objects/map/Map.obj");
-	gMapModel = &mapModel;
-	Animation walkAnimation(("_rooster/objects/catman/CatBoi_Walk.dae"), &ourModel);
-	Animation standAnimation(("_rooster/objects/catman/CatBoi_Idle.dae"), &ourModel);
-	Animation jumpAnimation(("_rooster/objects/catman/CatBoi_Jump.dae"), &ourModel);
-	Animation punchAnimation(("_rooster/objects/catman/CatBoi_Punch.dae"), &ourModel);
+	UniformStats::CacheEnabled() = cacheUniforms;
+	ModelShaderUniforms staticUniforms;
+	staticUniforms.Bind(staticShader);
+	SkyShaderUniforms skyUniforms;
+	skyUniforms.Bind(skyShader);
+	UniformStats::TakeCalls();
+
+	// texture objects are created up front so decoded images can be uploaded as they arrive
+	// -----------------------------------------------------------------------------------
+	unsigned int planeTexture;
+	glGenTextures(1, &planeTexture);
+	glBindTexture(GL_TEXTURE_2D, planeTexture);
+
+	// set the texture wrapping/filtering options (on currently bound texture)
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	unsigned int skyTexture;
+	glGenTextures(1, &skyTexture);
+	glBindTexture(GL_TEXTURE_2D, skyTexture);
+
+	// set the texture wrapping/filtering options (on currently bound texture)
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// load models, clips, textures and collision data
+	// -----------------------------------------------
+	// decoding runs on worker threads; the Models are built on this thread because
+	// their meshes create GL buffers as they load
+	ThreadPool loadPool(asyncAssetLoading ? std::thread::hardware_concurrency() : 1);
+	AssetLoader loader(loadPool);
+
+	DecodedImage brickImage, skyImage;
+	AssetTask brickTask = loader.Add("brick001.png",
+		[&]() { brickImage.data = stbi_load("_rooster/textures/brick001.png", &brickImage.width, &brickImage.height, &brickImage.nrChannels, 0); },
+		{}, [&]() { UploadTexture(planeTexture, brickImage); });
+	AssetTask skyTask = loader.Add("SkyCat.png",
+		[&]() { skyImage.data = stbi_load("_rooster/textures/SkyCat.png", &skyImage.width, &skyImage.height, &skyImage.nrChannels, 0); },
+		{}, [&]() { UploadTexture(skyTexture, skyImage); });
+
+	// Model runs its Assimp import and creates its meshes' GL buffers in one constructor,
+	// so the import stays on this thread with the upload; workers read the files in
+	// first so that at least the disk reads are off it
+	AssetTask characterReadTask = loader.Add("CatBoi_Walk.dae read",
+		[]() { PrefetchFile("_rooster/objects/catman/CatBoi_Walk.dae"); });
+	AssetTask mapReadTask = loader.Add("Map.obj read",
+		[]() { PrefetchFile("_rooster/objects/map/Map.obj"); });
+
+	std::unique_ptr<Model> ourModelPtr, mapModelPtr;
+	AssetTask characterTask = loader.AddMainThread("CatBoi_Walk.dae model",
+		[&]() { ourModelPtr.reset(new Model("_rooster/objects/catman/CatBoi_Walk.dae")); }, { characterReadTask });
+	AssetTask mapTask = loader.AddMainThread("Map.obj model",
+		[&]() { mapModelPtr.reset(new Model("_rooster/objects/map/Map.obj")); }, { mapReadTask });
+
+	// one per .dae, shared by its .anim and .poses caches so the file is read at most once;
+	// the tasks below hand each one on through their dependencies
+	std::vector<SourceFile> clipSources(std::begin(clipPaths), std::end(clipPaths));
+
+	// stale clip caches are rebaked in parallel; they do not need the model
+	std::vector<AssetTask> clipDependencies = { characterTask };
+	for (int i = 0; useAnimationCache && i < 4; i++)
+	{
+		clipDependencies.push_back(loader.Add(std::string(clipPaths[i]) + " cache", [i, &clipSources]()
+			{
+				std::string cachePath = std::string(clipPaths[i]) + ".anim";
+				if (!AnimationCache::IsCurrent(cachePath, clipSources[i]))
+					AnimationCache::Bake(clipSources[i], cachePath);
+			}));
+	}
+
+	// one task for all clips: resolving their bone ids adds bones to the character model
+	Animation walkAnimation;
+	Animation standAnimation;
+	Animation jumpAnimation;
+	Animation punchAnimation;
+	Animation* clips[] = { &walkAnimation, &standAnimation, &jumpAnimation, &punchAnimation };
+	AssetTask animationTask = loader.Add("animations", [&]()
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				if (useAnimationCache)
+					LoadAnimation(*clips[i], clipSources[i], ourModelPtr.get());
+				else
+					clips[i]->Load(clipPaths[i], ourModelPtr.get());
+			}
+		}, clipDependencies);
+
+	CollisionCache mapCollisionCache;
+	CollisionMesh mapMesh;
+	CollisionBVH mapBVH;
+	CollisionGrid mapGrid;
+	AssetTask collisionTask = loader.Add("collision", [&]()
+		{
+			LoadMapCollision(*mapModelPtr, "_rooster/objects/map/Map.obj", mapCollisionCache, mapMesh, mapBVH);
+			if (useGridBroadphase)
+				mapGrid.Build(mapMesh, gridCellSize);
+		}, { mapTask });
+
+	// the game needs every asset before its first frame
+	loader.Wait({ brickTask, skyTask, characterTask, mapTask, animationTask, collisionTask });
+	loader.PrintTimings();
+	Model& ourModel = *ourModelPtr;
+	Model& mapModel = *mapModelPtr;
+
+	gMapMesh = &mapMesh;
+	gMapGrid = &mapGrid;
+	if (useGridBroadphase)
+	{
+		std::cout << "Collision grid: " << mapGrid.GetEntryCount() << " cell entries, "
+			<< mapGrid.GetMemoryUsage() / 1024 << " KB" << std::endl;
+	}
+	std::cout << "Collision mesh: " << mapMesh.GetTriangleCount() << " triangles, "
+		<< (mapMesh.GetMemoryUsage() + mapBVH.GetMemoryUsage()) / 1024 << " KB (indexed vertex data: "
+		<< CollisionMesh::GetIndexedMemoryUsage(mapModel) / 1024 << " KB)" << std::endl;
+	if (benchmarks.Has("collision-layout"))
+		BenchmarkCollisionLayout(mapModel, mapMesh, benchmarkSettings); // before packing releases the Vertex data
+	if (benchmarks.Has("collision-grid"))
+		BenchmarkCollisionGrid(mapMesh, benchmarkSettings);
+	if (benchmarks.Has("agent-collision"))
+		BenchmarkAgentCollision(mapMesh, mapBVH, benchmarkSettings);
+
+	// packed and unpacked vertices disagree on the id of an unused bone slot, so the
+	// models are either all packed or all drawn from their own buffers
+	if (usePackedVertices && !(PackedModel::IsPackable(ourModel) && PackedModel::IsPackable(mapModel)))
+	{
+		std::cout << "Bone ids past " << (int)PackedModel::NO_BONE - 1 << ", drawing the models unpacked" << std::endl;
+		usePackedVertices = false;
+	}
+
+	// the character uses the skinned variant, built once for the vertex layout chosen above
+	std::vector<std::string> skinnedDefines = { "SKINNED" };
+	if (usePackedVertices)
+		skinnedDefines.push_back("PACKED_VERTEX");
+	if (!uploadBonePalette)
+		skinnedDefines.push_back("BONE_UNIFORMS");
+	Shader ourShader = MakeShaderVariant(staticShader, "anim_model.vs", "anim_model.fs", skinnedDefines);
+	if (ourShader.ID == 0)
+	{
+		glfwTerminate();
+		return -1;
+	}
+	ModelShaderUniforms modelUniforms;
+	modelUniforms.Bind(ourShader);
+	UniformStats::TakeCalls();
+
+	// compact copies of the models' vertex data, drawn instead of the Models' own buffers
+	PackedModel packedCharacter, packedMap;
+	if (usePackedVertices)
+	{
+		auto pack = [](Model& model, PackedModel& packed, const char* name)
+			{
+				double start = glfwGetTime();
+				packed.Build(model);
+				glFinish();
+				std::cout << "Packed " << name << ": " << packed.GetMeshCount() << " meshes ("
+					<< packed.GetSkinnedMeshCount() << " skinned), vertices "
+					<< PackedModel::GetSourceVertexMemoryUsage(model) / 1024 << " -> " << packed.GetVertexMemoryUsage() / 1024
+					<< " KB, indices " << PackedModel::GetSourceIndexMemoryUsage(model) / 1024 << " -> "
+					<< packed.GetIndexMemoryUsage() / 1024 << " KB, uploaded in " << (glfwGetTime() - start) * 1000.0
+					<< " ms" << std::endl;
+			};
+		pack(ourModel, packedCharacter, "CatBoi");
+		pack(mapModel, packedMap, "Map");
+	}
 	Animator animator(&standAnimation);
 	jumpAnimation.setLoopKey(50.0f);
 
+	const char* clipNames[] = { "walk", "stand", "jump", "punch" };
+
+	// on the source keys, before compression or resampling replace them
+	if (benchmarks.Has("pose-evaluation"))
+		BenchmarkPoseEvaluation(clips, clipNames, 4);
+	if (benchmarks.Has("resampled-clips"))
+		BenchmarkResampledClips(clips, clipNames, 4, benchmarkSettings);
+
+	if (compressAnimations)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			Animation* clip = clips[i];
+			clip->Compress(compressPositionTolerance, compressRotationTolerance, compressScaleTolerance);
+
+			const CompressedClip& compressed = clip->GetCompressedClip();
+			size_t sourceBytes = ResampledClip::GetKeyframeMemoryUsage(clip->GetBones());
+			float positionError, rotationError, scaleError;
+			compressed.MeasureError(clip->GetBones(), positionError, rotationError, scaleError);
+			bool withinTolerance = positionError <= compressPositionTolerance * 1.01f
+				&& rotationError <= compressRotationTolerance * 1.01f
+				&& scaleError <= compressScaleTolerance * 1.01f;
+
+			std::cout << "Compressed " << clipNames[i] << ": "
+				<< CompressedClip::GetSourceKeyCount(clip->GetBones()) << " -> " << compressed.GetKeyCount() << " keys, "
+				<< sourceBytes << " -> " << compressed.GetMemoryUsage() << " bytes ("
+				<< (float)sourceBytes / compressed.GetMemoryUsage() << ":1), max error "
+				<< positionError << " pos, " << rotationError << " rad, " << scaleError << " scale"
+				<< (withinTolerance ? "" : " EXCEEDS TOLERANCE") << std::endl;
+		}
+	}
+
+	if (resampleAnimations)
+	{
+		for (Animation* clip : clips)
+		{
+			clip->Resample(resampleRate);
+			std::cout << "Resampled clip" << (compressAnimations ? " (from the compressed keys)" : "") << ": "
+				<< clip->GetResampledClip().GetFrameCount() << " frames, "
+				<< clip->GetResampledClip().GetMemoryUsage() / 1024 << " KB (keyframes: "
+				<< ResampledClip::GetKeyframeMemoryUsage(clip->GetBones()) / 1024 << " KB)" << std::endl;
+		}
+	}
+
+	// after compression and resampling, which the baked matrices then include
+	BakedPoseTable bakedPoses[4];
+	if (bakeAnimationPoses)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			double bakeStart = glfwGetTime();
+			LoadBakedPoses(*clips[i], clipSources[i], bakedPoseRate, bakedPoses[i]);
+			bakedPoses[i].SetInterpolate(interpolateBakedPoses);
+			clips[i]->SetBakedPoses(&bakedPoses[i]);
+
+			// cost of one full evaluation, which a table lookup replaces every frame
+			std::vector<BoneCursor> cursors;
+			PoseScratch scratch;
+			std::vector<glm::mat4> pose(100);
+			double evalStart = glfwGetTime();
+			for (int k = 0; k < 100; k++)
+				EvaluateAnimationPose(*clips[i], clips[i]->GetDuration() * k / 100.0f, cursors, scratch, pose.data(), pose.size());
+			double evalMs = (glfwGetTime() - evalStart) * 1000.0 / 100;
+
+			double lookupStart = glfwGetTime();
+			for (int k = 0; k < 100; k++)
+				bakedPoses[i].Sample(clips[i]->GetDuration() * k / 100.0f, pose.data(), pose.size());
+			double lookupMs = (glfwGetTime() - lookupStart) * 1000.0 / 100;
+
+			std::cout << "Baked poses " << clipNames[i] << ": " << bakedPoses[i].GetFrameCount() << " frames, "
+				<< bakedPoses[i].GetMemoryUsage() / 1024 << " KB, ready in " << (evalStart - bakeStart) * 1000.0
+				<< " ms; per frame " << evalMs << " ms evaluated vs " << lookupMs << " ms baked" << std::endl;
+		}
+	}
+
+	if (useAnimationLOD)
+	{
+		animator.SetLODBands({
+			{ 8.0f, 0.0f, 0 },    // near: every frame, all bones
+			{ 20.0f, 30.0f, 1 },  // 30 Hz, leaf bones keep their bind pose
+			{ 50.0f, 10.0f, 2 },  // 10 Hz, two levels of leaves culled
+		});
+	}
+
+	// with the clips as the game plays them: compressed, resampled or baked
+	if (benchmarks.Has("crowd"))
+		BenchmarkCrowd(clips, 4, crowdSize > 0 ? crowdSize : 1000);
+
+	// crowd instances share the clips above and only own their playback state
+	CrowdAnimator crowd;
+	std::unique_ptr<ThreadPool> crowdPool;
+	if (crowdSize > 0)
+	{
+		for (int i = 0; i < crowdSize; i++)
+		{
+			Animation* clip = clips[i % 4];
+			crowd.AddInstance(clip, fmod(i * 7.31f, clip->GetDuration()), 0.8f + 0.05f * (i % 8));
+		}
+		crowdPool.reset(new ThreadPool());
+	}
+
 	// draw in wireframe
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
@@ -236,36 +584,6 @@ int main()
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 	glBindVertexArray(0);
 
-	unsigned int planeTexture;
-	glGenTextures(1, &planeTexture);
-	glBindTexture(GL_TEXTURE_2D, planeTexture);
-
-	// set the texture wrapping/filtering options (on currently bound texture)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load("_rooster/textures/brick001.png", &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		GLenum format = GL_RGB;
-		if (nrChannels == 1)
-			format = GL_RED;
-		else if (nrChannels == 3)
-			format = GL_RGB;
-		else if (nrChannels == 4)
-			format = GL_RGBA;
-
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "Failed to load texture" << std::endl;
-	}
-	stbi_image_free(data);
 
 	// skybox VAO
 	std::vector<float> skyVert;
@@ -288,35 +606,34 @@ int main()
 	glEnableVertexAttribArray(2);
 	glBindVertexArray(0);
 
-	unsigned int skyTexture;
-	glGenTextures(1, &skyTexture);
-	glBindTexture(GL_TEXTURE_2D, skyTexture);
-
-	// set the texture wrapping/filtering options (on currently bound texture)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-	unsigned char* data2 = stbi_load("_rooster/textures/SkyCat.png", &width, &height, &nrChannels, 0);
-	if (data2)
+	// skinning matrices go up in one uniform buffer write per frame, only for the bones the model uses
+	BonePalette bonePalette;
+	std::vector<std::string> boneUniformNames;
+	if (uploadBonePalette)
 	{
-		GLenum format = GL_RGB;
-		if (nrChannels == 1)
-			format = GL_RED;
-		else if (nrChannels == 3)
-			format = GL_RGB;
-		else if (nrChannels == 4)
-			format = GL_RGBA;
-
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data2);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		bonePalette.Create();
+		bonePalette.Attach(ourShader.ID);
 	}
 	else
 	{
-		std::cout << "Failed to load texture" << std::endl;
+		// uniform names are built once so the per-frame bone upload does not allocate
+		for (size_t i = 0; i < animator.GetBoneMatrices().size(); i++)
+			boneUniformNames.push_back("finalBonesMatrices[" + std::to_string(i) + "]");
+	}
+	size_t activeBones = std::min((size_t)ourModel.GetBoneCount(), (size_t)BonePalette::MAX_BONES);
+	double boneUploadTime = 0.0;
+	int boneUploadFrames = 0;
+
+	if (benchmarks.Has("shader-variants"))
+		BenchmarkShaderVariants(mapModel, usePackedVertices ? &packedMap : nullptr, ourShader, modelUniforms, staticShader, staticUniforms);
+	if (benchmarks.IsActive())
+	{
+		glfwTerminate();
+		return 0;
 	}
-	stbi_image_free(data2);
+
+	std::cout << "Startup took " << (glfwGetTime() - startupStart) * 1000.0 << " ms" << std::endl;
 
 	// render loop
 	// -----------
@@ -330,10 +647,34 @@ int main()
 
 		// ========== UPDATE JUMP PHYSICS ==========
 		// Apply gravity
+		glm::vec3 frameStart = modelPosition;
 		jumpVelocity += gravity * deltaTime;
-		modelPosition.y += jumpVelocity * deltaTime;
 
-		jumpVelocity = ResolveVerticalCollision(modelPosition, 0.7f, mapModel, jumpVelocity);
+		// sweep the fall instead of teleporting, so a long frame can not drop the cat
+		// through a thin platform; stopping a hair inside the surface lets the floor
+		// resolution below pick the contact up
+		glm::vec3 fall(0.0f, jumpVelocity * deltaTime, 0.0f);
+		SweepHit fallHit;
+		if (jumpVelocity < 0.0f && SweepSphereMap(mapMesh, mapBVH, modelPosition, groundHeight, fall, fallHit))
+			modelPosition.y += fall.y * fallHit.toi - sweepSkin;
+		else
+			modelPosition += fall;
+
+		// the map triangles this frame can touch come from the contact cache, which only
+		// queries the BVH again once the player leaves the cached region; the floor
+		// resolution and every TryMove in processInput only test these
+		// (WASD moves along at most two axes, the floor snap lifts by at most one radius)
+		float reach = groundHeight + 2.0f * walkSpeed * deltaTime;
+		glm::vec3 sweepMin = glm::min(frameStart, modelPosition) - glm::vec3(reach, 2.0f * groundHeight, reach);
+		glm::vec3 sweepMax = glm::max(frameStart, modelPosition) + glm::vec3(reach, 2.0f * groundHeight, reach);
+		const CollisionCandidates& frameCandidates = gContactCache.Update(mapBVH, sweepMin, sweepMax);
+
+		if (useFloorRaycast)
+			jumpVelocity = ResolveVerticalRaycast(modelPosition, groundHeight, mapMesh, mapBVH, jumpVelocity);
+		else if (useGridBroadphase)
+			jumpVelocity = ResolveVerticalCollision(modelPosition, groundHeight, mapMesh, mapGrid, jumpVelocity);
+		else
+			jumpVelocity = ResolveVerticalCollision(modelPosition, groundHeight, mapMesh, frameCandidates, jumpVelocity);
 
 		// ===== Respawn if player falls off map =====
 		if (modelPosition.y < -50.0f)
@@ -360,6 +701,14 @@ int main()
 		// input
 		// -----
 		processInput(window);
+
+		if (printCollisionStats)
+		{
+			std::cout << "Collision: " << frameCandidates.GetTriangleCount() << " candidates, "
+				<< frameCandidates.GetTrianglesTested() << " triangles tested of "
+				<< mapMesh.GetTriangleCount() << ", contact cache hit rate "
+				<< gContactCache.GetHitRate() * 100.0f << "%" << std::endl;
+		}
 		
 		Animation* desiredAnim = nullptr;
 
@@ -395,7 +744,15 @@ int main()
 		if (!hasJump)
 			animDelta *= jumpAnimSpeed;
 
+		animator.SetLODDistance(glm::length(camera.Position - modelPosition));
 		animator.UpdateAnimation(animDelta);
+		animator.SwapPoseBuffers();
+
+		if (printAnimationStats)
+			std::cout << "Animation: " << animator.GetBonesEvaluated() << " bones evaluated" << std::endl;
+
+		if (crowdPool)
+			crowd.Update(deltaTime, crowdPool.get());
 
 		if (animationLocked)
 		{
@@ -433,17 +790,24 @@ int main()
 		// view/projection transformations
 		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 2000.0f);
 		glm::mat4 view = camera.GetViewMatrix();
-		ourShader.setMat4("projection", projection);
-		ourShader.setMat4("view", view);
-		ourShader.setVec3("sunDirection", glm::normalize(glm::vec3(-0.3f, -1.0f, -0.2f)));
-		ourShader.setVec3("sunColor", glm::vec3(1.0f, 1.0f, 0.95f)); // slightly warm
-		ourShader.setFloat("sunIntensity", 1.0f);   // 5 is very bright
-		ourShader.setFloat("shininess", 64.0f);
-		ourShader.setVec3("viewPos", camera.Position);
-
-		auto transforms = animator.GetFinalBoneMatrices();
-		for (int i = 0; i < transforms.size(); ++i)
-			ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
+		modelUniforms.SetFrame(projection, view, camera.Position);
+
+		double uploadStart = glfwGetTime();
+		BoneMatrixView transforms = animator.GetBoneMatrices();
+		if (uploadBonePalette)
+			bonePalette.Upload(transforms.data, std::min(transforms.size(), activeBones));
+		else
+			for (size_t i = 0; i < transforms.size() && i < boneUniformNames.size(); ++i)
+				ourShader.setMat4(boneUniformNames[i], transforms[i]);
+		boneUploadTime += glfwGetTime() - uploadStart;
+		if (printBoneUploadTime && ++boneUploadFrames == 300)
+		{
+			std::cout << "Bone upload (" << (uploadBonePalette ? "palette" : "per bone") << "): "
+				<< (uploadBonePalette ? activeBones : boneUniformNames.size()) << " matrices, "
+				<< boneUploadTime * 1000000.0 / boneUploadFrames << " us per frame" << std::endl;
+			boneUploadTime = 0.0;
+			boneUploadFrames = 0;
+		}
 
 		modelYaw = -orbitYaw;
 
@@ -452,43 +816,55 @@ int main()
 		model = glm::translate(model, modelPosition);
 		model = glm::rotate(model, glm::radians(modelYaw), glm::vec3(0.0f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(0.5f));
-		ourShader.setMat4("model", model);
-		ourModel.Draw(ourShader);
+		modelUniforms.model.Set(model);
+		if (usePackedVertices)
+			packedCharacter.Draw(ourShader);
+		else
+			ourModel.Draw(ourShader);
 
 		// render plane with texture
 		glm::mat4 modelPlane = glm::mat4(1.0f);
-		ourShader.setMat4("model", modelPlane);
-		ourShader.setBool("useTexture", true);
+		modelUniforms.model.Set(modelPlane);
+		modelUniforms.useTexture.Set(true);
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, planeTexture);
-		ourShader.setInt("texture1", 0);
+		modelUniforms.texture1.Set(0);
 		//glBindVertexArray(planeVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 		glBindVertexArray(0);
 
 		// Draw Map Model
-		ourShader.use();
+		staticShader.use();
+		staticUniforms.SetFrame(projection, view, camera.Position);
 		glm::mat4 mapModelMatrix = glm::mat4(1.0f);
-		ourShader.setMat4("model", mapModelMatrix);
-		mapModel.Draw(ourShader);
+		staticUniforms.model.Set(mapModelMatrix);
+		if (usePackedVertices)
+			packedMap.Draw(staticShader);
+		else
+			mapModel.Draw(staticShader);
 
 		//SkyBoxRender
 		glDepthFunc(GL_LEQUAL);
 		skyShader.use();
-		skyShader.setMat4("uProjection", projection);
-		skyShader.setMat4("uView", glm::mat4(glm::mat3(view)));
+		skyUniforms.projection.Set(projection);
+		skyUniforms.view.Set(glm::mat4(glm::mat3(view)));
 		glm::mat4 skyModel = glm::mat4(1.0f);
 		skyModel = glm::rotate(skyModel, glm::radians(90.0f), glm::vec3(1, 0, 0));
 		skyModel = glm::scale(skyModel, glm::vec3(2000.f));
-		skyShader.setMat4("uModel", skyModel);
+		skyUniforms.model.Set(skyModel);
 
 		glBindVertexArray(skyboxVAO);
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, skyTexture);
-		skyShader.setInt("uSkyTex", 0);
+		skyUniforms.skyTex.Set(0);
 		glDrawElements(GL_TRIANGLES, skyInd.size(), GL_UNSIGNED_INT, 0);
 		glBindVertexArray(0);
 		glDepthFunc(GL_LESS);
+
+		// Model::Draw sets its texture samplers by name and is not counted
+		int uniformCalls = UniformStats::TakeCalls();
+		if (printUniformCalls)
+			std::cout << "Uniform GL calls this frame: " << uniformCalls << std::endl;
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
@@ -508,7 +884,7 @@ void processInput(GLFWwindow* window)
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
 
-	float moveSpeed = 4.0f * deltaTime;
+	float moveSpeed = walkSpeed * deltaTime;
 
 	glm::vec3 forward(
 		sin(glm::radians(modelYaw)),
@@ -523,9 +899,11 @@ void processInput(GLFWwindow* window)
 		{
 			glm::vec3 attempt = modelPosition + direction * moveSpeed;
 
-			float radius = 0.5f;
+			bool blocked = useGridBroadphase
+				? CheckMapCollision(attempt, wallRadius, *gMapMesh, *gMapGrid)
+				: CheckMapCollision(attempt, wallRadius, *gMapMesh, gContactCache.GetCandidates());
 
-			if (!CheckMapCollision(attempt, radius, *gMapModel))
+			if (!blocked)
 			{
 				modelPosition = attempt;
 			}
@@ -717,3 +1095,73 @@ inline void CreatingSphere(std::vector<float>& vertex, std::vector<unsigned int>
 		}
 	}
 }
+
+// Uploads an image decoded off the main thread and frees the decoded pixels
+void UploadTexture(unsigned int texture, DecodedImage& image)
+{
+	if (!image.data)
+	{
+		std::cout << "Failed to load texture" << std::endl;
+		return;
+	}
+
+	GLenum format = GL_RGB;
+	if (image.nrChannels == 1)
+		format = GL_RED;
+	else if (image.nrChannels == 3)
+		format = GL_RGB;
+	else if (image.nrChannels == 4)
+		format = GL_RGBA;
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	stbi_image_free(image.data);
+	image.data = nullptr;
+}
+
+// Draws the map with each shader variant, rasterizer discarded so only vertex work is timed
+void BenchmarkShaderVariants(Model& map, const PackedModel* packedMap, Shader& skinnedShader,
+	ModelShaderUniforms& skinnedUniforms, Shader& staticShader, ModelShaderUniforms& staticUniforms)
+{
+	size_t indexCount = 0;
+	for (const Mesh& mesh : map.meshes)
+		indexCount += mesh.indices.size();
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 2000.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 20.0f, 40.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	Shader* shaders[] = { &skinnedShader, &staticShader };
+	ModelShaderUniforms* uniforms[] = { &skinnedUniforms, &staticUniforms };
+	const char* names[] = { "skinned", "static" };
+
+	glEnable(GL_RASTERIZER_DISCARD);
+	for (int v = 0; v < 2; v++)
+	{
+		shaders[v]->use();
+		uniforms[v]->SetFrame(projection, view, glm::vec3(0.0f, 20.0f, 40.0f));
+		uniforms[v]->model.Set(glm::mat4(1.0f));
+		// warm up: shader compilation is often deferred to the first draw
+		if (packedMap)
+			packedMap->Draw(*shaders[v]);
+		else
+			map.Draw(*shaders[v]);
+		glFinish();
+
+		const int DRAWS = 20;
+		double start = glfwGetTime();
+		for (int i = 0; i < DRAWS; i++)
+		{
+			if (packedMap)
+				packedMap->Draw(*shaders[v]);
+			else
+				map.Draw(*shaders[v]);
+		}
+		glFinish();
+		double ms = (glfwGetTime() - start) * 1000.0 / DRAWS;
+
+		std::cout << "Map with " << names[v] << " shader: " << ms << " ms per draw, "
+			<< indexCount / ms / 1000.0 << " M vertices/s (" << indexCount << " vertices)" << std::endl;
+	}
+	glDisable(GL_RASTERIZER_DISCARD);
+}
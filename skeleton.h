@@ -0,0 +1,101 @@
+#pragma once
+
+/* Flattened node hierarchy of an Animation, compiled once after loading.
+   Nodes are stored parent-before-child with integer parent indices, and the bone
+   channel, final matrix slot and offset matrix of each node are resolved up front,
+   so evaluating a pose is one linear loop with no string or map lookups. */
+
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <learnopengl/animdata.h>
+#include <learnopengl/bone.h>
+#include <learnopengl/pose_simd.h>
+
+struct SkeletonNode
+{
+	glm::mat4 transformation;	// bind-pose local transform, used when the node has no channel
+	glm::mat4 offset;			// bone offset matrix, valid when boneIndex >= 0
+	int parent;					// -1 for the root
+	int channel;				// index into the Animation's bones, -1 if not animated
+	int boneIndex;				// slot in the final bone matrices, -1 if not a bone
+	int height;					// levels below the node to its deepest leaf, 0 for leaves
+	Affine3x4 bindAffine;		// transformation and offset as 3x4s for the pose kernels
+	Affine3x4 offsetAffine;
+};
+
+class Skeleton
+{
+public:
+	template <typename Node>
+	void Compile(const Node& root, const std::map<std::string, BoneInfo>& boneInfoMap,
+		const std::vector<Bone>& bones)
+	{
+		m_Nodes.clear();
+		m_Names.clear();
+
+		std::map<std::string, int> channelIndex;
+		for (int i = 0; i < (int)bones.size(); i++)
+			channelIndex[bones[i].GetBoneName()] = i;
+
+		AddNode(root, -1, boneInfoMap, channelIndex);
+
+		// children follow their parent, so one reverse pass settles every height
+		m_ChannelHeights.assign(bones.size(), 0);
+		for (int i = (int)m_Nodes.size() - 1; i >= 0; i--)
+		{
+			const SkeletonNode& node = m_Nodes[i];
+			if (node.parent >= 0)
+				m_Nodes[node.parent].height = std::max(m_Nodes[node.parent].height, node.height + 1);
+			if (node.channel >= 0)
+				m_ChannelHeights[node.channel] = std::max(m_ChannelHeights[node.channel], node.height);
+		}
+	}
+
+	inline const std::vector<SkeletonNode>& GetNodes() const { return m_Nodes; }
+	inline const std::string& GetNodeName(int index) const { return m_Names[index]; }
+	inline int GetNodeCount() const { return (int)m_Nodes.size(); }
+	// Largest height of the nodes driven by each channel
+	inline const std::vector<int>& GetChannelHeights() const { return m_ChannelHeights; }
+
+private:
+	template <typename Node>
+	void AddNode(const Node& src, int parent, const std::map<std::string, BoneInfo>& boneInfoMap,
+		const std::map<std::string, int>& channelIndex)
+	{
+		SkeletonNode node;
+		node.transformation = src.transformation;
+		node.offset = glm::mat4(1.0f);
+		node.parent = parent;
+		node.channel = -1;
+		node.boneIndex = -1;
+		node.height = 0;
+
+		auto channel = channelIndex.find(src.name);
+		if (channel != channelIndex.end())
+			node.channel = channel->second;
+
+		auto boneInfo = boneInfoMap.find(src.name);
+		if (boneInfo != boneInfoMap.end())
+		{
+			node.boneIndex = boneInfo->second.id;
+			node.offset = boneInfo->second.offset;
+		}
+
+		node.bindAffine = AffineFromMat4(node.transformation);
+		node.offsetAffine = AffineFromMat4(node.offset);
+
+		int index = (int)m_Nodes.size();
+		m_Nodes.push_back(node);
+		m_Names.push_back(src.name);
+
+		for (int i = 0; i < src.childrenCount; i++)
+			AddNode(src.children[i], index, boneInfoMap, channelIndex);
+	}
+
+	std::vector<SkeletonNode> m_Nodes;
+	std::vector<std::string> m_Names;
+	std::vector<int> m_ChannelHeights;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+/* Fixed set of worker threads with work stealing. Each worker owns a job deque:
+   jobs submitted from a worker go to its own deque and are popped newest first,
+   jobs submitted from outside are dealt round-robin, and a worker whose deque is
+   empty steals the oldest job of another before going to sleep. ParallelFor
+   splits an index range into chunks that the workers and the calling thread pull
+   until none are left, and returns once every chunk has run. */
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+class ThreadPool
+{
+public:
+    // threadCount includes the calling thread, so ThreadPool(1) runs everything inline
+    ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency())
+    {
+        if (threadCount == 0)
+            threadCount = 1;
+
+        for (unsigned int i = 1; i < threadCount; i++)
+            m_Queues.emplace_back(new WorkQueue());
+        for (unsigned int i = 1; i < threadCount; i++)
+            m_Workers.emplace_back([this, i]() { WorkerLoop((int)i - 1); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_WakeMutex);
+            m_Stopping = true;
+        }
+        m_Wake.notify_all();
+
+        for (std::thread& worker : m_Workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs job on a worker, or inline when the pool has no workers
+    void Submit(std::function<void()> job)
+    {
+        if (m_Workers.empty())
+        {
+            job();
+            return;
+        }
+
+        int self = CurrentWorker();
+        size_t queue = self >= 0 ? (size_t)self : m_NextQueue.fetch_add(1, std::memory_order_relaxed) % m_Queues.size();
+        {
+            std::lock_guard<std::mutex> lock(m_Queues[queue]->mutex);
+            m_Queues[queue]->jobs.push_back(std::move(job));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_WakeMutex);
+            m_Pending++;
+        }
+        m_Wake.notify_one();
+    }
+
+    // Calls fn(begin, end) over [0, count) in chunks of at most grain indices
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+    {
+        if (count == 0)
+            return;
+        if (grain == 0)
+            grain = 1;
+
+        size_t chunkCount = (count + grain - 1) / grain;
+        if (m_Workers.empty() || chunkCount == 1)
+        {
+            fn(0, count);
+            return;
+        }
+
+        // helpers that start after the last chunk is taken only touch the shared state
+        auto state = std::make_shared<ForState>();
+        state->fn = fn;
+        state->count = count;
+        state->grain = grain;
+        state->chunkCount = chunkCount;
+
+        size_t helpers = std::min(m_Workers.size(), chunkCount - 1);
+        for (size_t i = 0; i < helpers; i++)
+            Submit([state]() { RunChunks(*state); });
+
+        RunChunks(*state);
+        while (state->finished.load(std::memory_order_acquire) < chunkCount)
+            std::this_thread::yield();
+    }
+
+    inline unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size() + 1; }
+
+private:
+    struct ForState
+    {
+        std::function<void(size_t, size_t)> fn;
+        size_t count;
+        size_t grain;
+        size_t chunkCount;
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> finished{ 0 };
+    };
+
+    static void RunChunks(ForState& state)
+    {
+        for (;;)
+        {
+            size_t chunk = state.next.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= state.chunkCount)
+                return;
+
+            size_t begin = chunk * state.grain;
+            size_t end = std::min(begin + state.grain, state.count);
+            state.fn(begin, end);
+            state.finished.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    struct WorkerId
+    {
+        const ThreadPool* pool;
+        int index;
+    };
+
+    static WorkerId& ThisThread()
+    {
+        static thread_local WorkerId id = { nullptr, -1 };
+        return id;
+    }
+
+    // Index of the calling thread's worker in this pool, -1 for other threads
+    int CurrentWorker() const
+    {
+        return ThisThread().pool == this ? ThisThread().index : -1;
+    }
+
+    bool PopLocal(int index, std::function<void()>& job)
+    {
+        WorkQueue& queue = *m_Queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            return false;
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    bool Steal(int thief, std::function<void()>& job)
+    {
+        for (size_t k = 1; k < m_Queues.size(); k++)
+        {
+            WorkQueue& queue = *m_Queues[(thief + k) % m_Queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty())
+                continue;
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void WorkerLoop(int index)
+    {
+        ThisThread().pool = this;
+        ThisThread().index = index;
+
+        for (;;)
+        {
+            std::function<void()> job;
+            if (PopLocal(index, job) || Steal(index, job))
+            {
+                m_Pending.fetch_sub(1, std::memory_order_relaxed);
+                job();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_WakeMutex);
+            m_Wake.wait(lock, [this]() { return m_Stopping || m_Pending.load(std::memory_order_relaxed) > 0; });
+            if (m_Stopping && m_Pending.load(std::memory_order_relaxed) == 0)
+                return;
+        }
+    }
+
+    std::vector<std::thread> m_Workers;
+    std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+    std::atomic<size_t> m_NextQueue{ 0 };
+    std::atomic<int> m_Pending{ 0 };    // jobs queued but not yet taken
+    std::mutex m_WakeMutex;
+    std::condition_variable m_Wake;
+    bool m_Stopping = false;
+};